@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace NuGeom {
+
+/// Walker alias table for sampling an index with probability proportional to a set of weights.
+/// Building the table is O(n) (Vose's method), and each sample costs one uniform random number
+/// and one comparison, independent of the number of weights
+class AliasTable {
+    public:
+        AliasTable() = default;
+        /// Builds the table, throws if a weight is negative or all weights are zero
+        explicit AliasTable(const std::vector<double> &weights) { Build(weights); }
+
+        /// Rebuilds the table only if the weights differ from the ones it was built with.
+        /// Allows keeping one table per material (or per energy bin) and updating it cheaply
+        ///@param weights: The new weights
+        ///@return bool: True if the table was rebuilt
+        bool Update(const std::vector<double> &weights);
+
+        /// Samples an index
+        ///@param ran: Uniform random number in [0, 1)
+        ///@return size_t: Index in [0, Size()) drawn with probability weight[i]/sum(weights)
+        size_t Sample(double ran) const {
+            const double scaled = ran*static_cast<double>(m_prob.size());
+            auto idx = static_cast<size_t>(scaled);
+            if(idx >= m_prob.size()) idx = m_prob.size() - 1;
+            return scaled - static_cast<double>(idx) < m_prob[idx] ? idx : m_alias[idx];
+        }
+
+        size_t Size() const { return m_prob.size(); }
+        bool Empty() const { return m_prob.empty(); }
+        const std::vector<double>& Weights() const { return m_weights; }
+        /// Normalized probability of index i
+        double Probability(size_t i) const { return m_weights[i]/m_sum; }
+
+    private:
+        void Build(const std::vector<double>&);
+
+        std::vector<double> m_weights;
+        std::vector<double> m_prob;
+        std::vector<size_t> m_alias;
+        double m_sum{};
+};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "geom/Element.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace NuGeom {
+
+/// Thread safe memoization of an expensive cross section calculator, for when the energies are
+/// not known in advance and a CrossSectionTable can not be built. Energies are quantized to bins
+/// of the given relative width and the calculator is evaluated at the center of the bin, so the
+/// cached values do not depend on which energy was seen first or on the thread it ran on.
+/// The cache is split into shards with their own lock, and a shard is cleared when it is full
+class CrossSectionCache {
+    public:
+        using Calculator = std::function<double(const Element&, double)>;
+
+        ///@param calculator: Cross section of an element at a given energy
+        ///@param tolerance: Relative width of the energy bins
+        ///@param capacity: Maximum number of cached values
+        CrossSectionCache(Calculator, double tolerance=1e-4, size_t capacity=1 << 16);
+        CrossSectionCache(const CrossSectionCache&) = delete;
+        CrossSectionCache& operator=(const CrossSectionCache&) = delete;
+
+        double operator()(const Element&, double energy);
+
+        size_t Hits() const { return m_hits; }
+        size_t Misses() const { return m_misses; }
+        size_t Size() const;
+        void Clear();
+
+    private:
+        struct Key {
+            size_t Z, A;
+            int64_t bin;
+            bool operator==(const Key &other) const {
+                return Z == other.Z && A == other.A && bin == other.bin;
+            }
+        };
+        struct KeyHash {
+            size_t operator()(const Key &key) const {
+                size_t hash = std::hash<int64_t>{}(key.bin);
+                hash ^= std::hash<size_t>{}(key.Z*1000 + key.A) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+                return hash;
+            }
+        };
+        struct Shard {
+            std::unordered_map<Key, double, KeyHash> values;
+            mutable std::mutex mutex;
+        };
+        static constexpr size_t nshards = 16;
+
+        Calculator m_calculator;
+        double m_log_width;
+        size_t m_shard_capacity;
+        std::array<Shard, nshards> m_shards;
+        std::atomic<size_t> m_hits{0}, m_misses{0};
+};
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "geom/AliasTable.hh"
+#include "geom/Element.hh"
+#include "geom/MaterialTable.hh"
+
+#include <functional>
+#include <vector>
+
+namespace NuGeom {
+
+/// Cross sections of every material in a MaterialTable tabulated on an energy grid.
+/// The user calculator is evaluated once per element and grid point when the table is built,
+/// lookups interpolate log-log between the grid points (log-linear where a value is zero).
+/// The cross section of a material is the sum over its elements of mass fraction times the
+/// element cross section, so the macroscopic cross section is this times the density
+class CrossSectionTable {
+    public:
+        using Calculator = std::function<double(const Element&, double)>;
+
+        CrossSectionTable() = default;
+        /// Builds the table for all materials currently in the material table
+        ///@param calculator: Cross section of an element at a given energy
+        ///@param energies: Strictly increasing, positive energy grid with at least two points
+        ///@param materials: The materials to tabulate, looked up by MaterialId
+        CrossSectionTable(const Calculator&, std::vector<double>,
+                          const MaterialTable& = MaterialTable::Global());
+
+        /// Tabulates the materials added to the material table since the table was built,
+        /// on the same energy grid. Materials that are already tabulated are kept
+        ///@param calculator: Cross section of an element at a given energy
+        ///@param materials: The materials to tabulate, looked up by MaterialId
+        void Extend(const Calculator&, const MaterialTable& = MaterialTable::Global());
+
+        /// Logarithmically spaced energy grid with n points from min to max
+        static std::vector<double> LogSpaced(double min, double max, size_t n);
+
+        /// Cross section of a material, energies outside the grid are clamped to the grid
+        double Total(MaterialId, double energy) const;
+        /// Contribution of each element of the material (mass fraction times cross section)
+        ///@param id: The material
+        ///@param energy: The energy to evaluate at
+        ///@param contributions: Filled with one entry per element, reused across calls
+        void Contributions(MaterialId id, double energy, std::vector<double> &contributions) const;
+        /// Alias table over the element contributions at the grid point below the energy,
+        /// built once with the table for sampling the target element
+        const AliasTable& ElementSampler(MaterialId, double energy) const;
+        /// Samples the index of the target element within the material in constant time, from the
+        /// alias tables of the two grid points around the energy. The grid point is chosen by its
+        /// share of the interpolated total, so the result follows the interpolated contributions
+        ///@param id: The material
+        ///@param energy: The energy of the neutrino, clamped to the grid
+        ///@param ran: Uniform random number in [0, 1)
+        size_t SampleElement(MaterialId id, double energy, double ran) const;
+
+        const std::vector<double>& Energies() const { return m_energies; }
+        size_t NMaterials() const { return m_materials.size(); }
+
+    private:
+        struct Entry {
+            size_t nelements{};
+            // Values are stored per grid point, total first and then the elements
+            std::vector<double> values;
+            std::vector<AliasTable> samplers;
+        };
+
+        const Entry& Get(MaterialId) const;
+        /// Index of the grid interval and the position in log energy within it
+        std::pair<size_t, double> Locate(double energy) const;
+        static double Interpolate(double, double, double);
+
+        std::vector<double> m_energies, m_log_energies;
+        std::vector<Entry> m_materials;
+};
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "geom/FluxWindow.hh"
+#include "geom/MaterialTable.hh"
+#include "geom/World.hh"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace NuGeom {
+
+/// Areal density (density times path length) of each material and of all materials together,
+/// projected along the rays through an nu x nv grid of pixel centers over a FluxWindow.
+/// Pixel (iu, iv) is the ray at fractions ((iu + 0.5)/nu, (iv + 0.5)/nv) of the window
+class DensityMap {
+    public:
+        DensityMap() = default;
+        /// Map with all densities set to zero
+        ///@param nu: Number of pixels along the first edge of the window
+        ///@param nv: Number of pixels along the second edge of the window
+        ///@param names: Names of the materials, indexed by MaterialId
+        DensityMap(size_t nu, size_t nv, std::vector<std::string> names);
+
+        /// Traces the ray of every pixel in parallel with World::ColumnDensity
+        ///@param world: The geometry
+        ///@param window: The window the rays start from
+        ///@param nu: Number of pixels along the first edge of the window
+        ///@param nv: Number of pixels along the second edge of the window
+        ///@param nthreads: Number of threads, 0 uses all hardware threads
+        static DensityMap Trace(const World&, const FluxWindow&, size_t nu, size_t nv, size_t nthreads=0);
+
+        size_t NU() const { return m_nu; }
+        size_t NV() const { return m_nv; }
+        size_t NPixels() const { return m_nu*m_nv; }
+        size_t NMaterials() const { return m_names.size(); }
+        const std::vector<std::string>& MaterialNames() const { return m_names; }
+
+        /// Areal density of all materials in a pixel
+        double Total(size_t iu, size_t iv) const { return m_total[Pixel(iu, iv)]; }
+        /// Areal density of one material in a pixel
+        double Density(MaterialId id, size_t iu, size_t iv) const {
+            return m_density[id*NPixels() + Pixel(iu, iv)];
+        }
+        /// Total areal density of every pixel, with iu running fastest
+        const std::vector<double>& Totals() const { return m_total; }
+        /// Areal density of every pixel for each material, with the material id running slowest
+        const std::vector<double>& Densities() const { return m_density; }
+
+        /// Writes the map as a binary file: the magic "NUGEOMDM", the format version, nu, nv and
+        /// the number of materials as little endian uint64, the material names each as a uint64
+        /// length followed by the characters, then the total map and the per material maps as
+        /// little endian float64
+        void Write(const std::string &filename) const;
+        /// Reads a map written by Write
+        static DensityMap Read(const std::string &filename);
+        /// Writes a 16 bit grayscale PNG of the total map or of one material, scaled to the
+        /// maximum of the map. The v axis points up in the image
+        void WritePNG(const std::string &filename, std::optional<MaterialId> id=std::nullopt) const;
+
+    private:
+        size_t Pixel(size_t iu, size_t iv) const { return iv*m_nu + iu; }
+
+        static constexpr char magic[] = "NUGEOMDM";
+        static constexpr uint64_t version = 1;
+
+        size_t m_nu{}, m_nv{};
+        std::vector<std::string> m_names{};
+        std::vector<double> m_total{}, m_density{};
+};
+
+}
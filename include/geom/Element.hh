@@ -1,7 +1,13 @@
 #pragma once
 
+#include "geom/PeriodicTable.hh"
+
+#include <deque>
 #include <map>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 
 namespace YAML {
 class Node;
@@ -16,10 +22,19 @@ class Element {
         size_t m_Z{};
         size_t m_A{};
         double m_mass{};
+        ElementId m_id{};
+
+        void AssignId(size_t A);
 
     public:
         Element() = default;
+        /// Looks up a user defined element by name or symbol, and falls back to the periodic table
         Element(const std::string&);
+        /// Natural element from the periodic table
+        explicit Element(ElementId);
+        /// User defined element. Elements without a mass number A share the id of the natural
+        /// element with the same Z if their mass matches its standard atomic weight. Otherwise,
+        /// or if A is given, they are registered as isotopes, with A rounded from the mass if needed
         Element(const std::string&, size_t, double, size_t=0);
         Element(const std::string&, const std::string&,
                 size_t, double, size_t=0);
@@ -29,7 +44,7 @@ class Element {
         Element& operator=(Element &&) = default;
 
         bool operator==(const Element &other) const {
-            return m_Z == other.m_Z;
+            return m_id == other.m_id;
         }
         bool operator!=(const Element &other) const {
             return !(*this == other);
@@ -40,12 +55,17 @@ class Element {
         size_t Z() const { return m_Z; }
         size_t A() const { return m_A; }
         double Mass() const { return m_mass; }
+        ElementId Id() const { return m_id; }
 
-        static std::map<std::string, Element> &CommonElements() {
-            static std::map<std::string, Element> common_elements;
+        static std::unordered_map<std::string, Element> &CommonElements() {
+            static std::unordered_map<std::string, Element> common_elements;
             return common_elements;
         }
 
+        /// Relative difference to the standard atomic weight up to which a mass is taken to be
+        /// the natural element, which covers the rounding of the weights in common data files
+        static constexpr double natural_mass_tolerance = 1e-3;
+
         template<typename OStream>
         friend OStream& operator<<(OStream &os, const Element &elm) {
             os << "Element(" << elm.m_name << ", " << elm.m_symbol << ", " << elm.m_Z << ", " << elm.m_mass << ")";
@@ -53,6 +73,36 @@ class Element {
         }
 };
 
+/// Registry of the isotopes defined by the user. Each (Z, A, mass) gets a unique ElementId
+/// numbered after the natural elements of the periodic table
+class IsotopeRegistry {
+    public:
+        struct Isotope {
+            size_t Z, A;
+            double mass;
+        };
+
+        IsotopeRegistry() = default;
+        IsotopeRegistry(const IsotopeRegistry&) = delete;
+        IsotopeRegistry& operator=(const IsotopeRegistry&) = delete;
+
+        static IsotopeRegistry& Global();
+
+        /// Registers an isotope if it is not present yet
+        ///@return ElementId: The id of the isotope
+        ElementId Add(size_t Z, size_t A, double mass);
+        /// Looks up an isotope by id, throws if the id is not a registered isotope
+        const Isotope& Get(ElementId id) const;
+        size_t Size() const { return m_isotopes.size(); }
+
+        static constexpr ElementId FirstId = PeriodicTable::MaxZ + 1;
+
+    private:
+        std::deque<Isotope> m_isotopes;
+        std::map<std::tuple<size_t, size_t, double>, ElementId> m_ids;
+        mutable std::mutex m_mutex;
+};
+
 void LoadElements(const YAML::Node&);
 
 }
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "geom/Vector3D.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace NuGeom {
+
+/// Fixed size record of a flux file, one per neutrino. The layout is the on disk format, so
+/// records of a mapped file are used in place without copying or parsing
+struct FluxRecord {
+    double position[3];
+    double direction[3];
+    double energy;
+    /// Weight of the neutrino from the flux simulation
+    double weight;
+    /// PDG code, decay mode and energy of the parent the neutrino was produced by
+    int32_t parent_pdg;
+    int32_t parent_decay;
+    double parent_energy;
+
+    Vector3D Position() const { return {position[0], position[1], position[2]}; }
+    Vector3D Direction() const { return {direction[0], direction[1], direction[2]}; }
+};
+static_assert(sizeof(FluxRecord) == 80 && std::is_trivially_copyable_v<FluxRecord>,
+              "FluxRecord has to match the layout of the flux files");
+
+/// View of consecutive records of a flux source, valid as long as the source is alive.
+/// First is the index of the first record within the source, to be used as the event number
+/// so the random streams of each neutrino do not depend on how the source is split up
+struct FluxBatch {
+    const FluxRecord *records{};
+    size_t size{};
+    uint64_t first{};
+
+    const FluxRecord* begin() const { return records; }
+    const FluxRecord* end() const { return records + size; }
+    const FluxRecord& operator[](size_t i) const { return records[i]; }
+    bool Empty() const { return size == 0; }
+};
+
+/// Source of neutrinos for the interaction sampler, handed out in batches
+class FluxDriver {
+    public:
+        virtual ~FluxDriver() = default;
+        /// Next batch of at most max_size records, empty once the source is exhausted
+        virtual FluxBatch Next(size_t max_size) = 0;
+};
+
+/// Streams the records [begin, end) of an array owned elsewhere, e.g. a shard of a MappedFluxFile
+class FluxStream : public FluxDriver {
+    public:
+        FluxStream(const FluxRecord *records, size_t begin, size_t end)
+            : m_records{records}, m_next{begin}, m_end{end} {}
+
+        FluxBatch Next(size_t max_size) override {
+            const size_t size = std::min(max_size, m_end - m_next);
+            FluxBatch batch{m_records + m_next, size, m_next};
+            m_next += size;
+            return batch;
+        }
+        /// Number of records left
+        size_t Remaining() const { return m_end - m_next; }
+
+    private:
+        const FluxRecord *m_records;
+        size_t m_next, m_end;
+};
+
+/// Flux file mapped into memory. The file starts with the magic "NUGEOMFX", the format version
+/// and the size of a record as uint64, followed by the records in the byte order of the machine
+/// that wrote them. Pages are read in by the OS on first access, so opening is cheap regardless
+/// of the size of the file, and records are handed out without copies
+class MappedFluxFile {
+    public:
+        explicit MappedFluxFile(const std::string &filename);
+        ~MappedFluxFile();
+        MappedFluxFile(const MappedFluxFile&) = delete;
+        MappedFluxFile& operator=(const MappedFluxFile&) = delete;
+
+        size_t Size() const { return m_size; }
+        const FluxRecord* Records() const { return m_records; }
+        const FluxRecord& operator[](size_t i) const { return m_records[i]; }
+
+        /// Streams all records of the file
+        FluxStream Stream() const { return {m_records, 0, m_size}; }
+        /// Streams one of nshards contiguous parts of the file of (nearly) equal size, e.g. one per thread
+        FluxStream Shard(size_t index, size_t nshards) const;
+
+        /// Writes records in the format read by MappedFluxFile
+        static void Write(const std::string &filename, const std::vector<FluxRecord> &records);
+
+    private:
+        static constexpr char magic[] = "NUGEOMFX";
+        static constexpr uint64_t version = 1;
+        static constexpr size_t header_size = 3*sizeof(uint64_t);
+
+        void *m_mapping{};
+        size_t m_mapping_size{};
+        const FluxRecord *m_records{};
+        size_t m_size{};
+};
+
+}
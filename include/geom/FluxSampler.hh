@@ -0,0 +1,69 @@
+#pragma once
+
+#include "geom/AliasTable.hh"
+#include "geom/DensityMap.hh"
+#include "geom/FluxWindow.hh"
+#include "geom/Random.hh"
+#include "geom/Ray.hh"
+#include "geom/World.hh"
+
+#include <vector>
+
+namespace NuGeom {
+
+/// Settings of the importance map of the FluxSampler
+struct FluxSamplerOptions {
+    /// Pixels of the coarse density map traced through the world
+    size_t nu{32}, nv{32};
+    /// Importance of each material per unit areal density, indexed by MaterialId. Set it to
+    /// zero for materials that are not of interest (e.g. air), or to the cross section per unit
+    /// mass to follow the interaction probability. All materials count equally if empty
+    std::vector<double> material_weights{};
+    /// Fraction of the rays drawn uniformly over the window. Keeps the weights finite for parts
+    /// of the window that the coarse map sees as empty, but which may still hit small volumes
+    double uniform_fraction{0.01};
+    /// Number of threads used to trace the map, 0 uses all hardware threads
+    size_t nthreads{0};
+};
+
+/// Ray drawn by the FluxSampler, with its weight relative to uniform sampling over the window
+struct FluxRay {
+    Ray ray;
+    double weight{1};
+};
+
+/// Draws flux rays from a FluxWindow with the starting points sampled in proportion to the
+/// importance of each pixel of a coarse DensityMap, so rays that miss the detector or only
+/// cross air are rarely traced. The pixel is drawn from an alias table, and the point uniformly
+/// within the pixel. The weight undoes the importance sampling: averages of weight times an
+/// observable match those of uniformly sampled rays, so a flux per unit area is normalized
+/// by multiplying with the area of the window
+class FluxSampler {
+    public:
+        /// Traces the importance map through the world
+        FluxSampler(const World&, const FluxWindow&, const FluxSamplerOptions& = {});
+        /// Uses an existing map, e.g. read from disk, which has to cover the window. The grid
+        /// settings and number of threads of the options are not used
+        FluxSampler(const FluxWindow&, DensityMap, const FluxSamplerOptions& = {});
+
+        /// Draws a ray, using three random numbers of the stream
+        FluxRay Sample(RandomStream &rng) const {
+            const size_t pixel = m_pixels.Sample(rng.Uniform());
+            const double u = (static_cast<double>(pixel % m_map.NU()) + rng.Uniform())/static_cast<double>(m_map.NU());
+            const double v = (static_cast<double>(pixel / m_map.NU()) + rng.Uniform())/static_cast<double>(m_map.NV());
+            return {m_window.GetRay(u, v), m_weights[pixel]};
+        }
+
+        /// Probability to draw a ray from pixel (iu, iv)
+        double Probability(size_t iu, size_t iv) const { return m_pixels.Probability(iv*m_map.NU() + iu); }
+        const DensityMap& Map() const { return m_map; }
+        const FluxWindow& Window() const { return m_window; }
+
+    private:
+        FluxWindow m_window;
+        DensityMap m_map;
+        AliasTable m_pixels;
+        std::vector<double> m_weights;
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "geom/Ray.hh"
+#include "geom/Vector3D.hh"
+
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+
+namespace NuGeom {
+
+/// Parallelogram the flux rays start from, spanned by two edges from a corner. Rays either all
+/// go along one direction, or away from a point source. The window has to lie inside the world
+/// volume, since the navigation starts from the volume containing the origin of the ray
+class FluxWindow {
+    public:
+        FluxWindow() = default;
+        /// Window with a parallel beam
+        FluxWindow(const Vector3D &corner, const Vector3D &edge_u, const Vector3D &edge_v, const Vector3D &direction)
+            : m_corner{corner}, m_edge_u{edge_u}, m_edge_v{edge_v}, m_direction{direction.Unit()} {
+            if(!(Area() > 0)) throw std::runtime_error("FluxWindow: Edges of the window are parallel");
+        }
+        /// Window with rays coming from a point source
+        static FluxWindow FromPointSource(const Vector3D &corner, const Vector3D &edge_u, const Vector3D &edge_v,
+                                          const Vector3D &source) {
+            FluxWindow window(corner, edge_u, edge_v, (corner + 0.5*(edge_u + edge_v) - source));
+            window.m_source = source;
+            return window;
+        }
+
+        const Vector3D& Corner() const { return m_corner; }
+        const Vector3D& EdgeU() const { return m_edge_u; }
+        const Vector3D& EdgeV() const { return m_edge_v; }
+        /// Direction of the beam, or from the source to the center of the window
+        const Vector3D& Direction() const { return m_direction; }
+        const std::optional<Vector3D>& Source() const { return m_source; }
+        double Area() const { return m_edge_u.Cross(m_edge_v).Norm(); }
+
+        /// Point on the window at fractions (u, v) in [0, 1] along the two edges
+        Vector3D Point(double u, double v) const { return m_corner + u*m_edge_u + v*m_edge_v; }
+        /// Ray starting at fractions (u, v) of the window
+        Ray GetRay(double u, double v) const {
+            auto point = Point(u, v);
+            return {point, m_source ? point - *m_source : m_direction};
+        }
+
+    private:
+        Vector3D m_corner{}, m_edge_u{}, m_edge_v{}, m_direction{0, 0, 1};
+        std::optional<Vector3D> m_source{};
+};
+
+}
@@ -1,19 +1,52 @@
 #pragma once
 
+#include "geom/CrossSectionCache.hh"
+#include "geom/CrossSectionTable.hh"
 #include "geom/Element.hh"
+#include "geom/Flux.hh"
 #include "geom/Material.hh"
+#include "geom/Parallel.hh"
 #include "geom/Parser.hh"
+#include "geom/Random.hh"
 #include "geom/World.hh"
 #include "geom/Ray.hh"
+#include "geom/Units.hh"
 #include "geom/LineSegment.hh"
+#include <algorithm>
+#include <cmath>
 #include <functional>
 #include <numeric>
 
 namespace NuGeom {
 
+/// Neutrino to generate an interaction vertex for
+struct Neutrino {
+    Vector3D position, direction;
+    double energy;
+};
+
+/// Interaction vertices generated for a batch of neutrinos, stored as one array per quantity with
+/// one entry per neutrino. The weight is the probability that the neutrino interacts in the
+/// detector. Neutrinos that cross no material get a weight of zero and material and element id 0
+struct InteractionVertices {
+    std::vector<Vector3D> positions;
+    std::vector<MaterialId> materials;
+    std::vector<ElementId> elements;
+    std::vector<double> weights;
+
+    void Resize(size_t size) {
+        positions.resize(size);
+        materials.resize(size);
+        elements.resize(size);
+        weights.resize(size);
+    }
+    size_t Size() const { return weights.size(); }
+};
+
 class DetectorSim {
 public:
     DetectorSim() {}; // Setup the detector (user cin interface)
+    DetectorSim(World detector) : world{std::move(detector)} {}
     DetectorSim(const std::string &filename) {
         pugi::xml_document doc;
         pugi::xml_parse_result result = doc.load_file(filename.c_str());
@@ -24,56 +57,166 @@ public:
         world = parse.GetWorld();
         m_mats = parse.GetMaterials();
     }
-    bool SetCrossSectionCalculator(std::function<double(const NuGeom::Element&, double)> func) {
+    /// Tabulates the cross sections of all the materials on the energy grid. Materials added
+    /// afterwards are tabulated before the next interactions are generated
+    bool SetCrossSectionCalculator(std::function<double(const NuGeom::Element&, double)> func,
+                                   std::vector<double> energies=CrossSectionTable::LogSpaced(1*Units::MeV, 1e5*Units::MeV, 500)) {
         m_func = func;
+        m_xsec = CrossSectionTable(m_func, std::move(energies));
+        m_cache.reset();
         return true;
     }
+    /// Evaluates the cross sections on demand through a memoizing cache instead of a table,
+    /// for calculators that are expensive but have no natural energy grid
+    ///@param func: Cross section of an element at a given energy
+    ///@param tolerance: Relative width of the energy bins the cache is keyed on
+    ///@param capacity: Maximum number of cached cross sections
+    bool SetCachedCrossSectionCalculator(std::function<double(const NuGeom::Element&, double)> func,
+                                         double tolerance=1e-4, size_t capacity=1 << 16) {
+        m_func = func;
+        m_cache = std::make_shared<CrossSectionCache>(m_func, tolerance, capacity);
+        return true;
+    }
+    /// The cache used by SetCachedCrossSectionCalculator, nullptr if the table is used
+    const CrossSectionCache* GetCrossSectionCache() const { return m_cache.get(); }
 
+    /// Samples the interaction vertex and target of a single neutrino. Consecutive calls use
+    /// consecutive event numbers of the seed set with SetSeed
     std::pair<Vector3D, NuGeom::Element> GetInteraction(Vector3D position, Vector3D direction, double energy) {
-        NuGeom::Ray ray(position, direction);
-        auto segments = world.GetLineSegments(ray);
-        auto mfp = GetMeanFreePath(energy);
-        Vector3D point;
-        NuGeom::Element elm;
-        // Choose interaction point
-        std::vector<double> probs(segments.size());
-        for(const auto &path : mfp) {
-            std::cout << path.first.Name() << " " << path.second << std::endl;
-        }
-        size_t idx = 0;
-        double total_prob = std::accumulate(segments.begin(), segments.end(), 0.0, [mfp, &probs, &idx](double a, LineSegment &b) {
-            std::cout << b.GetMaterial().Name() << std::endl;
-            auto mean_free_path = mfp.at(b.GetMaterial());
-            probs[idx] = 1-exp(-b.Length()/mean_free_path);
-            std::cout << idx << " " << probs[idx] << " " << b.Length() << " " << mean_free_path << std::endl;
-            return a + probs[idx++];
+        std::vector<SegmentRecord> segments;
+        std::vector<double> buffer;
+        InteractionVertices vertex;
+        vertex.Resize(1);
+        TabulateNewMaterials();
+        auto elm_idx = GenerateInteraction({position, direction, energy}, m_seed, m_event++,
+                                           segments, buffer, vertex, 0);
+        if(vertex.weights[0] == 0) return {vertex.positions[0], NuGeom::Element()};
+        return {vertex.positions[0], MaterialTable::Global().Get(vertex.materials[0]).Elements()[elm_idx]};
+    }
+    void SetSeed(uint64_t seed) {
+        m_seed = seed;
+        m_event = 0;
+    }
+
+    /// Samples the interaction vertex and target for each neutrino of the batch in parallel.
+    /// Each neutrino draws its random numbers from a counter based stream keyed by the seed and
+    /// its index, so the results are bit identical for any number of threads
+    ///@param neutrinos: The neutrinos to generate interactions for
+    ///@param seed: Seed of the run
+    ///@param vertices: Filled with one vertex per neutrino, reused across calls
+    ///@param nthreads: Number of worker threads, 0 uses all hardware threads
+    void GenerateInteractions(const std::vector<Neutrino> &neutrinos, uint64_t seed,
+                              InteractionVertices &vertices, size_t nthreads=0) const {
+        GenerateBatch(neutrinos.size(), seed, 0, vertices, nthreads,
+                      [&](size_t i) { return neutrinos[i]; });
+    }
+
+    /// Samples the interaction vertices for a batch of flux records, read in place from the
+    /// flux source. The event number of each neutrino is its index within the source, so the
+    /// results do not depend on the batch size or on how the source is sharded. The weights
+    /// include the flux weights of the records
+    void GenerateInteractions(const FluxBatch &batch, uint64_t seed,
+                              InteractionVertices &vertices, size_t nthreads=0) const {
+        GenerateBatch(batch.size, seed, batch.first, vertices, nthreads, [&](size_t i) {
+            return Neutrino{batch[i].Position(), batch[i].Direction(), batch[i].energy};
         });
-        std::cout << "Total prob = " << total_prob << std::endl;
-        // Choose element from material at interaction point
-        return {point, elm};
+        for(size_t i = 0; i < batch.size; ++i) vertices.weights[i] *= batch[i].weight;
     }
 
 private:
-    std::map<NuGeom::Material, double> GetMeanFreePath(double nu_energy) {
-        std::map<NuGeom::Material, double> mfp;
-        // Fill result mfp
-        for(size_t i = 0; i < m_mats.size(); ++i) {
-            mfp[m_mats[i]] = 1.0/(CalcCrossSection(m_mats[i], nu_energy)*m_mats[i].Density());
+    template<typename GetNeutrino>
+    void GenerateBatch(size_t size, uint64_t seed, uint64_t first_event, InteractionVertices &vertices,
+                       size_t nthreads, const GetNeutrino &get_neutrino) const {
+        vertices.Resize(size);
+        TabulateNewMaterials();
+        std::vector<std::vector<SegmentRecord>> segments(ThreadCount(nthreads));
+        std::vector<std::vector<double>> buffers(segments.size());
+        ParallelFor(size, 256, segments.size(), [&](size_t thread, size_t begin, size_t end) {
+            for(size_t i = begin; i < end; ++i) {
+                GenerateInteraction(get_neutrino(i), seed, first_event + i, segments[thread], buffers[thread],
+                                    vertices, i);
+            }
+        });
+    }
+
+    /// Extends the table with the materials added since it was built. Called before any
+    /// worker threads start, so the table is only read while generating
+    void TabulateNewMaterials() const {
+        if(m_func && !m_cache) m_xsec.Extend(m_func);
+    }
+
+    /// Traces the neutrino and samples the vertex from the exponential attenuation along the
+    /// path, and the target element from the cross section contributions of the material
+    ///@return size_t: Index of the target within the elements of the material
+    size_t GenerateInteraction(const Neutrino &neutrino, uint64_t seed, uint64_t event,
+                               std::vector<SegmentRecord> &segments, std::vector<double> &buffer,
+                               InteractionVertices &vertices, size_t idx) const {
+        NuGeom::Ray ray(neutrino.position, neutrino.direction);
+        segments.clear();
+        world.GetLineSegments(ray, segments);
+
+        // Optical depth of each segment
+        buffer.resize(segments.size());
+        double total_depth = 0;
+        for(size_t i = 0; i < segments.size(); ++i) {
+            buffer[i] = segments[i].Length()/GetMeanFreePath(segments[i].material, neutrino.energy);
+            total_depth += buffer[i];
         }
-        return mfp;
+        const double weight = -std::expm1(-total_depth);
+        vertices.positions[idx] = neutrino.position;
+        vertices.materials[idx] = 0;
+        vertices.elements[idx] = 0;
+        vertices.weights[idx] = weight;
+        if(!(weight > 0)) return 0;
+
+        RandomStream rng(seed, event);
+
+        // Invert the probability to interact before the vertex, 1 - exp(-depth), given an interaction
+        const double depth = -std::log1p(-rng.Uniform()*weight);
+        double before = 0;
+        size_t isegment = 0;
+        while(isegment + 1 < segments.size() && before + buffer[isegment] < depth) before += buffer[isegment++];
+        // Rounding can push the depth past the last segment with material in it
+        while(isegment > 0 && !(buffer[isegment] > 0)) before -= buffer[--isegment];
+        const auto &segment = segments[isegment];
+        const double frac = buffer[isegment] > 0 ? std::min(1.0, (depth - before)/buffer[isegment]) : 0;
+        vertices.positions[idx] = ray.Propagate(segment.t_start + frac*segment.Length());
+        vertices.materials[idx] = segment.material;
+
+        const size_t ielement = SampleElement(segment.material, neutrino.energy, rng.Uniform(), buffer);
+        vertices.elements[idx] = MaterialTable::Global().Get(segment.material).Elements()[ielement].Id();
+        return ielement;
     }
 
-    double CalcCrossSection(const NuGeom::Element &elm, double nu_energy) {
-        return m_func(elm, nu_energy);
+    double GetMeanFreePath(MaterialId id, double nu_energy) const {
+        const auto &material = MaterialTable::Global().Get(id);
+        return 1.0/(CrossSection(id, nu_energy)*material.Density());
     }
 
-    double CalcCrossSection(const NuGeom::Material &mat, double nu_energy) {
+    /// Index of the target element within the material. The table samples from its alias tables,
+    /// the cache walks the contributions, which are evaluated anyway
+    size_t SampleElement(MaterialId id, double nu_energy, double ran, std::vector<double> &contributions) const {
+        if(!m_cache) return m_xsec.SampleElement(id, nu_energy, ran);
+
+        const auto &material = MaterialTable::Global().Get(id);
+        contributions.resize(material.NElements());
+        for(size_t i = 0; i < material.NElements(); ++i) {
+            contributions[i] = material.MassFractions()[i]*(*m_cache)(material.Elements()[i], nu_energy);
+        }
+        double target = ran*std::accumulate(contributions.begin(), contributions.end(), 0.0);
+        size_t ielement = 0;
+        while(ielement + 1 < contributions.size() && target >= contributions[ielement])
+            target -= contributions[ielement++];
+        return ielement;
+    }
+
+    double CrossSection(MaterialId id, double nu_energy) const {
+        if(!m_cache) return m_xsec.Total(id, nu_energy);
+
+        const auto &material = MaterialTable::Global().Get(id);
         double cross_section = 0;
-        std::cout << "Evaluating for " << mat.Name() << std::endl;
-        for(size_t i = 0; i < mat.NElements(); ++i) {
-            m_xsec[mat].push_back(mat.MassFractions()[i]*CalcCrossSection(mat.Elements()[i], nu_energy));
-            std::cout << mat.Elements()[i].Name() << " " << mat.MassFractions()[i] << " " << CalcCrossSection(mat.Elements()[i], nu_energy) << std::endl;
-            cross_section += m_xsec[mat].back();
+        for(size_t i = 0; i < material.NElements(); ++i) {
+            cross_section += material.MassFractions()[i]*(*m_cache)(material.Elements()[i], nu_energy);
         }
         return cross_section;
     }
@@ -81,7 +224,11 @@ private:
     NuGeom::World world;
     std::function<double(const NuGeom::Element&, double)> m_func;
     std::vector<NuGeom::Material> m_mats;
-    std::map<NuGeom::Material, std::vector<double>> m_xsec;
+    // Extended with new materials by the const generation methods, see TabulateNewMaterials
+    mutable CrossSectionTable m_xsec;
+    std::shared_ptr<CrossSectionCache> m_cache;
+    uint64_t m_seed{};
+    uint64_t m_event{};
 };
 
 }
@@ -1,33 +1,48 @@
 #pragma once
 
 #include "geom/Material.hh"
+#include "geom/MaterialTable.hh"
 #include "geom/Vector3D.hh"
 
+#include <cstdint>
 #include <memory>
 
 namespace NuGeom {
 
+/// Compact description of a segment of a ray, given by the distances along the ray where it
+/// enters and leaves a volume. Used by the tracing interfaces that fill a caller owned buffer
+struct SegmentRecord {
+    double t_start{}, t_end{};
+    MaterialId material{};
+    uint32_t volume{};
+
+    double Length() const { return t_end - t_start; }
+};
+
 class LineSegment {
     public:
         LineSegment() = default;
-        LineSegment(double length, Material mat) 
-            : m_length{length}, m_material{std::move(mat)} {}
+        LineSegment(double length, const Material &mat) 
+            : m_length{length}, m_material{MaterialTable::Global().Add(mat)} {}
         LineSegment(double length, size_t idx) 
             : m_length{length}, m_idx{idx} {}
-        LineSegment(Vector3D start, Vector3D end, Material mat) 
-            : m_start{start}, m_end{end}, m_material{std::move(mat)} { m_length = (end - start).Norm(); }
+        LineSegment(Vector3D start, Vector3D end, const Material &mat) 
+            : LineSegment(start, end, MaterialTable::Global().Add(mat)) {}
+        LineSegment(Vector3D start, Vector3D end, MaterialId mat) 
+            : m_start{start}, m_end{end}, m_material{mat} { m_length = (end - start).Norm(); }
 
         Vector3D Start() const { return m_start; }
         Vector3D End() const { return m_end; }
         double Length() const { return m_length; }
         size_t ShapeID() const { return m_idx; }
-        Material GetMaterial() const { return m_material; }
+        const Material& GetMaterial() const { return MaterialTable::Global().Get(m_material); }
+        MaterialId GetMaterialId() const { return m_material; }
 
     private:
         Vector3D m_start{}, m_end{};
         double m_length;
         size_t m_idx;
-        Material m_material;
+        MaterialId m_material{};
 };
 
 }
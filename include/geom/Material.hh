@@ -1,5 +1,6 @@
 #pragma once
 
+#include "geom/AliasTable.hh"
 #include "geom/Element.hh"
 
 #include <iostream>
@@ -34,13 +35,21 @@ class Material {
             : m_name{name}, m_density{density}, m_ncomponents{ncomponents} {}
 
         size_t NComponents() const { return m_ncomponents; }
-        std::vector<Element> Elements() const { return m_elements; }
-        std::vector<double> MassFractions() const { return m_fractions; }
+        const std::vector<Element>& Elements() const { return m_elements; }
+        const std::vector<double>& MassFractions() const { return m_fractions; }
         size_t NElements() const { return m_elements.size(); }
         void AddElement(const Element&, int);
         void AddElement(const Element&, double);
         void AddMaterial(const Material&, double);
+        /// Samples an element according to the mass fractions
         Element SelectElement(double) const;
+        /// Samples an element with an alias table built from any per element weights,
+        /// e.g. number fractions or fractions times cross sections
+        ///@param ran: Uniform random number in [0, 1)
+        ///@param sampler: Alias table with one weight per element of the material
+        Element SelectElement(double, const AliasTable&) const;
+        /// Relative number of atoms of each element (mass fraction over atomic mass)
+        std::vector<double> NumberFractions() const;
         double Density() const { return m_density; }
         std::string Name() const { return m_name; }
 
@@ -76,6 +85,7 @@ class Material {
         std::vector<int> m_natoms;
         double m_density;
         size_t m_ncomponents;
+        AliasTable m_sampler;
 
         static std::map<std::string, Material> s_materials;
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "geom/Material.hh"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace NuGeom {
+
+/// Compact handle to a material interned in the MaterialTable
+using MaterialId = uint32_t;
+
+/// Owns every material used by the geometry. Volumes and line segments refer to materials by
+/// MaterialId, so tracing does not copy materials, and per material data can be kept in plain
+/// arrays indexed by the id. Id 0 is an empty default material.
+/// Materials are added while the geometry is built, lookups are not synchronized with additions
+class MaterialTable {
+    public:
+        MaterialTable();
+        MaterialTable(const MaterialTable&) = delete;
+        MaterialTable& operator=(const MaterialTable&) = delete;
+
+        /// Table used by the volumes and line segments
+        static MaterialTable& Global();
+
+        /// Adds a material to the table if an identical one is not present yet
+        ///@param material: The material to add
+        ///@return MaterialId: The id of the material in the table
+        MaterialId Add(const Material&);
+
+        /// Looks up a material by id, throws if the id is not in the table
+        const Material& Get(MaterialId id) const {
+            if(id >= m_materials.size())
+                throw std::runtime_error("MaterialTable: Undefined material id " + std::to_string(id));
+            return m_materials[id];
+        }
+        size_t Size() const { return m_materials.size(); }
+
+    private:
+        static std::string Key(const Material&);
+
+        std::deque<Material> m_materials;
+        std::unordered_map<std::string, MaterialId> m_ids;
+        std::mutex m_mutex;
+};
+
+}
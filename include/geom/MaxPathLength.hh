@@ -0,0 +1,41 @@
+#pragma once
+
+#include "geom/FluxWindow.hh"
+#include "geom/MaterialTable.hh"
+#include "geom/World.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NuGeom {
+
+/// Settings of the maximum path length scan
+struct MaxPathLengthOptions {
+    /// Rays through the centers of an nu x nv grid over the window
+    size_t nu{100}, nv{100};
+    /// Additional rays from random points of the window
+    size_t nrandom{0};
+    /// Random rays are spread uniformly in solid angle within this angle (in radians)
+    /// around the direction of the window
+    double cone_angle{0};
+    /// Factor the maxima are multiplied with, to cover the rays missed by the scan
+    double safety_factor{1.1};
+    uint64_t seed{0};
+    /// Number of threads, 0 uses all hardware threads
+    size_t nthreads{0};
+    /// Directory the results are cached in, keyed by the geometry, window and settings.
+    /// Caching is disabled if empty
+    std::string cache_directory{};
+};
+
+/// Maximum column density (density times path length) of each material over rays through the
+/// flux window, as needed to normalize the interaction probabilities for unweighted event
+/// generation. The rays are traced in parallel with World::ColumnDensity
+///@param world: The geometry
+///@param window: The window the rays start from
+///@param options: Settings of the scan
+///@return std::vector<double>: Maximum column density of each material, indexed by MaterialId
+std::vector<double> MaxPathLengths(const World&, const FluxWindow&, const MaxPathLengthOptions& = {});
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace NuGeom {
+
+/// Number of worker threads to use, 0 selects all hardware threads
+inline size_t ThreadCount(size_t nthreads) {
+    if(nthreads != 0) return nthreads;
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+/// Calls func(thread, begin, end) for chunks of [0, size), with the chunks handed out to the
+/// threads on demand. The calling thread is used as thread 0, and the first exception thrown by
+/// a worker is rethrown after all threads finished
+///@param size: Number of items
+///@param chunk: Number of items per call
+///@param nthreads: Number of threads, 0 uses all hardware threads
+///@param func: Called with the thread index in [0, nthreads) and the range of items
+template<typename Func>
+void ParallelFor(size_t size, size_t chunk, size_t nthreads, const Func &func) {
+    chunk = std::max<size_t>(chunk, 1);
+    const size_t nchunks = (size + chunk - 1)/chunk;
+    nthreads = std::min(ThreadCount(nthreads), std::max<size_t>(nchunks, 1));
+
+    std::atomic<size_t> next_chunk{0};
+    std::vector<std::exception_ptr> errors(nthreads);
+    auto worker = [&](size_t thread) {
+        try {
+            for(size_t ichunk = next_chunk++; ichunk < nchunks; ichunk = next_chunk++) {
+                func(thread, ichunk*chunk, std::min(size, (ichunk + 1)*chunk));
+            }
+        } catch(...) {
+            errors[thread] = std::current_exception();
+            next_chunk = nchunks;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < nthreads; ++i) threads.emplace_back(worker, i);
+    worker(0);
+    for(auto &thread : threads) thread.join();
+    for(const auto &error : errors) {
+        if(error) std::rethrow_exception(error);
+    }
+}
+
+}
@@ -2,6 +2,7 @@
 
 #include "geom/Vector3D.hh"
 #include "geom/Transform3D.hh"
+#include "geom/Quaternion.hh"
 #include "geom/Element.hh"
 #include "geom/Material.hh"
 #include "geom/Shape.hh"
@@ -13,6 +14,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace NuGeom {
 
@@ -27,23 +29,35 @@ class GDMLParser : public Parser {
         double GetConstant(const std::string&) const;
         Vector3D GetPosition(const std::string&) const;
         Transform3D GetTransform(const std::string&) const;
+        Scale3D GetScale(const std::string&) const;
         Material GetMaterial(const std::string&) const;
         std::vector<Material> GetMaterials() const;
+        std::shared_ptr<Shape> GetShape(const std::string&) const;
+        std::shared_ptr<LogicalVolume> GetVolume(const std::string&) const;
 
     private:
         void ParseDefines(const pugi::xml_node&);
         void ParseMaterials(const pugi::xml_node&);
         void ParseSolids(const pugi::xml_node&);
         void ParseStructure(const pugi::xml_node&);
+        std::string SolidKey(const pugi::xml_node&) const;
+        /// Element referenced by a material component, resolved once per name
+        const Element& GetElement(const std::string&);
 
         std::map<std::string, double> m_def_constants;
         std::map<std::string, Vector3D> m_def_positions;
         std::map<std::string, Transform3D> m_def_rotations;
+        std::map<std::string, Scale3D> m_def_scales;
+        std::map<std::string, Element> m_elements;
         std::map<std::string, Material> m_materials;
         std::map<std::string, std::shared_ptr<Shape>> m_shapes;
         std::map<std::string, std::shared_ptr<LogicalVolume>> m_volumes;
         std::vector<std::shared_ptr<PhysicalVolume>> m_phys_vols;
 
+        // Interned solids and logical volumes, keyed on their type and parameters
+        std::unordered_map<std::string, std::shared_ptr<Shape>> m_shape_cache;
+        std::unordered_map<std::string, std::shared_ptr<LogicalVolume>> m_volume_cache;
+
         World m_world;
 };
 
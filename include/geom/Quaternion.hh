@@ -0,0 +1,96 @@
+#pragma once
+
+#include "geom/Ray.hh"
+#include "geom/Transform3D.hh"
+#include "geom/Vector3D.hh"
+
+namespace NuGeom {
+
+/// Unit quaternion w + x*i + y*j + z*k representing a rotation
+class Quaternion {
+    public:
+        constexpr Quaternion() = default;
+        constexpr Quaternion(double w, double x, double y, double z) : m_w{w}, m_x{x}, m_y{y}, m_z{z} {}
+        /// Rotation by angle (in radians) around the given axis
+        static Quaternion FromAxisAngle(const Vector3D&, double);
+        /// Rotation by x, then y, then z around the fixed axes, i.e. RotZ*RotY*RotX
+        static Quaternion FromEuler(double, double, double);
+        /// Extracts the rotation from the linear part of an orthonormal transform
+        static Quaternion FromRotation(const Transform3D&);
+
+        constexpr double W() const { return m_w; }
+        constexpr double X() const { return m_x; }
+        constexpr double Y() const { return m_y; }
+        constexpr double Z() const { return m_z; }
+
+        double Norm() const { return std::sqrt(m_w*m_w + m_x*m_x + m_y*m_y + m_z*m_z); }
+        Quaternion Unit() const {
+            double norm = Norm();
+            return {m_w/norm, m_x/norm, m_y/norm, m_z/norm};
+        }
+        constexpr Quaternion Conjugate() const { return {m_w, -m_x, -m_y, -m_z}; }
+
+        /// Hamilton product, (q1*q2).Rotate(v) == q1.Rotate(q2.Rotate(v))
+        constexpr Quaternion operator*(const Quaternion &other) const {
+            return {m_w*other.m_w - m_x*other.m_x - m_y*other.m_y - m_z*other.m_z,
+                    m_w*other.m_x + m_x*other.m_w + m_y*other.m_z - m_z*other.m_y,
+                    m_w*other.m_y - m_x*other.m_z + m_y*other.m_w + m_z*other.m_x,
+                    m_w*other.m_z + m_x*other.m_y - m_y*other.m_x + m_z*other.m_w};
+        }
+
+        constexpr Vector3D Rotate(const Vector3D &vec) const {
+            // v' = v + 2w (u x v) + 2 u x (u x v), with u the vector part
+            const Vector3D u{m_x, m_y, m_z};
+            const Vector3D t = 2*u.Cross(vec);
+            return vec + m_w*t + u.Cross(t);
+        }
+
+        Rotation3D ToRotation() const;
+
+        template<typename OStream>
+        friend OStream& operator<<(OStream &os, const Quaternion &quat) {
+            os << "Quaternion(" << quat.m_w << ", " << quat.m_x << ", " << quat.m_y << ", " << quat.m_z << ")";
+            return os;
+        }
+
+    private:
+        double m_w{1}, m_x{0}, m_y{0}, m_z{0};
+};
+
+/// Rotation followed by a translation, p -> R p + t. Composes with fewer operations than
+/// Transform3D, and the rotation stays orthonormal along long placement chains
+class RigidTransform3D {
+    public:
+        RigidTransform3D() = default;
+        RigidTransform3D(const Quaternion &rotation, const Vector3D &translation = {})
+            : m_rotation{rotation}, m_translation{translation} {}
+        /// Throws if the transform is not a proper rotation plus translation
+        explicit RigidTransform3D(const Transform3D&);
+        /// Checks if a transform is a proper rotation plus translation, i.e. if it can be converted
+        static bool IsRigid(const Transform3D&);
+
+        const Quaternion& GetRotation() const { return m_rotation; }
+        const Vector3D& GetTranslation() const { return m_translation; }
+
+        Vector3D Apply(const Vector3D &point) const { return m_rotation.Rotate(point) + m_translation; }
+        Vector3D ApplyDirection(const Vector3D &dir) const { return m_rotation.Rotate(dir); }
+        Ray Apply(const Ray &ray) const {
+            return {Apply(ray.Origin()), ApplyDirection(ray.Direction()), false, ray.MaxDistance()};
+        }
+
+        RigidTransform3D operator*(const RigidTransform3D &other) const {
+            return {(m_rotation*other.m_rotation).Unit(), Apply(other.m_translation)};
+        }
+        RigidTransform3D Inverse() const {
+            auto inverse = m_rotation.Conjugate();
+            return {inverse, -inverse.Rotate(m_translation)};
+        }
+
+        Transform3D ToTransform() const;
+
+    private:
+        Quaternion m_rotation;
+        Vector3D m_translation;
+};
+
+}
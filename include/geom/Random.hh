@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace NuGeom {
+
+/// Philox4x32-10 counter based random number generator (Salmon et al., SC'11). The output is a
+/// bijection of the counter for a given key, so any draw of any stream can be computed directly
+/// from (key, counter) without keeping or sharing generator state between threads
+class Philox4x32 {
+    public:
+        using Counter = std::array<uint32_t, 4>;
+        using Key = std::array<uint32_t, 2>;
+
+        static constexpr Counter Generate(Counter ctr, Key key) {
+            for(size_t round = 0; round < nrounds; ++round) {
+                if(round > 0) {
+                    key[0] += weyl0;
+                    key[1] += weyl1;
+                }
+                const uint64_t prod0 = uint64_t{mult0}*ctr[0];
+                const uint64_t prod1 = uint64_t{mult1}*ctr[2];
+                ctr = {static_cast<uint32_t>(prod1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(prod1),
+                       static_cast<uint32_t>(prod0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(prod0)};
+            }
+            return ctr;
+        }
+
+    private:
+        static constexpr size_t nrounds = 10;
+        static constexpr uint32_t mult0 = 0xD2511F53, mult1 = 0xCD9E8D57;
+        static constexpr uint32_t weyl0 = 0x9E3779B9, weyl1 = 0xBB67AE85;
+};
+
+/// Stream of random numbers keyed by the seed of the run and a stream index, e.g. the event
+/// number. Streams are independent of each other and of the order they are used in, so
+/// parallel results are identical for any number of threads or split of the work.
+/// Satisfies UniformRandomBitGenerator, so it can be used with the <random> distributions
+class RandomStream {
+    public:
+        using result_type = uint64_t;
+
+        constexpr RandomStream(uint64_t seed, uint64_t stream)
+            : m_key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+              m_stream{stream} {}
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        constexpr result_type operator()() {
+            // Each block of the generator gives two 64 bit numbers
+            if(m_next == 2) {
+                m_block = Philox4x32::Generate({static_cast<uint32_t>(m_counter), static_cast<uint32_t>(m_counter >> 32),
+                                                static_cast<uint32_t>(m_stream), static_cast<uint32_t>(m_stream >> 32)},
+                                               m_key);
+                ++m_counter;
+                m_next = 0;
+            }
+            const auto result = uint64_t{m_block[2*m_next]} << 32 | m_block[2*m_next + 1];
+            ++m_next;
+            return result;
+        }
+
+        /// Uniform number in [0, 1) with 53 random bits
+        constexpr double Uniform() { return static_cast<double>((*this)() >> 11)*0x1p-53; }
+
+    private:
+        Philox4x32::Key m_key;
+        uint64_t m_stream;
+        uint64_t m_counter{};
+        Philox4x32::Counter m_block{};
+        size_t m_next{2};
+};
+
+}
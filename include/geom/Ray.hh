@@ -2,22 +2,58 @@
 
 #include "geom/Vector3D.hh"
 
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
 namespace NuGeom {
 
-class Ray {
+/// Ray with a unit direction. The inverse direction and the direction signs are cached when
+/// the ray is built, so the slab tests of boxes and bounding volumes only need multiplications.
+/// Intersections further along the ray than the max distance are treated as misses
+template<typename T>
+class BasicRay {
     public:
-        Ray() = default;
-        Ray(const Vector3D &origin, const Vector3D &direction, bool normalize=true) 
-            : m_origin{origin}, m_direction{direction} {
-                if(normalize) m_direction = m_direction.Unit();
+        BasicRay() = default;
+        /// Directions that are already unit length (e.g. after a rigid transform) should be passed
+        /// with normalize = false to skip the redundant renormalization
+        BasicRay(const BasicVector3D<T> &origin, const BasicVector3D<T> &direction, bool normalize=true,
+                 T max_distance=std::numeric_limits<T>::infinity())
+            : m_origin{origin}, m_direction{normalize ? direction.Unit() : direction},
+              m_max_distance{max_distance} {
+                Prepare();
+            }
+        /// Converts a ray between precisions without renormalizing the direction
+        template<typename U>
+        explicit BasicRay(const BasicRay<U> &other)
+            : m_origin{other.Origin()}, m_direction{other.Direction()},
+              m_max_distance{static_cast<T>(other.MaxDistance())} {
+                Prepare();
             }
 
-        Vector3D Origin() const { return m_origin; }
-        Vector3D Direction() const { return m_direction; }
-        Vector3D Propagate(double t) const { return m_origin + t*m_direction; }
+        BasicVector3D<T> Origin() const { return m_origin; }
+        BasicVector3D<T> Direction() const { return m_direction; }
+        const BasicVector3D<T>& InverseDirection() const { return m_inv_direction; }
+        /// Returns 1 if the direction along the given axis is negative and 0 otherwise
+        size_t Sign(size_t axis) const { return (m_signs >> axis) & 1u; }
+        T MaxDistance() const { return m_max_distance; }
+        BasicVector3D<T> Propagate(T t) const { return m_origin + t*m_direction; }
 
     private:
-        Vector3D m_origin, m_direction;
+        void Prepare() {
+            m_inv_direction = T(1)/m_direction;
+            // signbit keeps the sign of the infinite inverse for directions of -0
+            m_signs = (std::signbit(m_direction.X()) ? 1u : 0u)
+                    | (std::signbit(m_direction.Y()) ? 2u : 0u)
+                    | (std::signbit(m_direction.Z()) ? 4u : 0u);
+        }
+
+        BasicVector3D<T> m_origin, m_direction, m_inv_direction;
+        T m_max_distance{std::numeric_limits<T>::infinity()};
+        unsigned m_signs{};
 };
 
+using Ray = BasicRay<double>;
+using RayF = BasicRay<float>;
+
 }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "geom/Ray.hh"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace NuGeom {
+
+/// Structure of arrays holding many rays, used by the batched tracing interfaces.
+/// Each component is stored contiguously, so loops over the batch read memory linearly
+/// and can be vectorized. The directions are assumed to be unit vectors
+template<typename T>
+class BasicRayBatch {
+    public:
+        BasicRayBatch() = default;
+        explicit BasicRayBatch(const std::vector<BasicRay<T>> &rays) {
+            Reserve(rays.size());
+            for(const auto &ray : rays) Add(ray);
+        }
+
+        size_t Size() const { return m_max_distance.size(); }
+        bool Empty() const { return m_max_distance.empty(); }
+        void Reserve(size_t size) {
+            for(auto *component : Components()) component -> reserve(size);
+        }
+        void Clear() {
+            for(auto *component : Components()) component -> clear();
+        }
+
+        void Add(const BasicRay<T> &ray) {
+            m_origin_x.push_back(ray.Origin().X());
+            m_origin_y.push_back(ray.Origin().Y());
+            m_origin_z.push_back(ray.Origin().Z());
+            m_direction_x.push_back(ray.Direction().X());
+            m_direction_y.push_back(ray.Direction().Y());
+            m_direction_z.push_back(ray.Direction().Z());
+            m_max_distance.push_back(ray.MaxDistance());
+        }
+        BasicRay<T> Get(size_t i) const {
+            return {Origin(i), Direction(i), false, m_max_distance[i]};
+        }
+        BasicVector3D<T> Origin(size_t i) const { return {m_origin_x[i], m_origin_y[i], m_origin_z[i]}; }
+        BasicVector3D<T> Direction(size_t i) const {
+            return {m_direction_x[i], m_direction_y[i], m_direction_z[i]};
+        }
+        T MaxDistance(size_t i) const { return m_max_distance[i]; }
+
+        // Access to the underlying arrays
+        const std::vector<T>& OriginX() const { return m_origin_x; }
+        const std::vector<T>& OriginY() const { return m_origin_y; }
+        const std::vector<T>& OriginZ() const { return m_origin_z; }
+        const std::vector<T>& DirectionX() const { return m_direction_x; }
+        const std::vector<T>& DirectionY() const { return m_direction_y; }
+        const std::vector<T>& DirectionZ() const { return m_direction_z; }
+        const std::vector<T>& MaxDistances() const { return m_max_distance; }
+
+    private:
+        std::array<std::vector<T>*, 7> Components() {
+            return {&m_origin_x, &m_origin_y, &m_origin_z,
+                    &m_direction_x, &m_direction_y, &m_direction_z, &m_max_distance};
+        }
+
+        std::vector<T> m_origin_x, m_origin_y, m_origin_z;
+        std::vector<T> m_direction_x, m_direction_y, m_direction_z;
+        std::vector<T> m_max_distance;
+};
+
+using RayBatch = BasicRayBatch<double>;
+using RayBatchF = BasicRayBatch<float>;
+
+}
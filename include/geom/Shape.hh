@@ -1,14 +1,18 @@
 #pragma once
 
 
+#include "geom/Ray.hh"
+#include "geom/RayBatch.hh"
 #include "geom/Vector3D.hh"
 #include "geom/Transform3D.hh"
+#include "geom/ShapeKernel.hh"
 
 #include <cmath>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <vector>
 
 namespace pugi {
 class xml_node;
@@ -16,7 +20,7 @@ class xml_node;
 
 namespace NuGeom {
 
-class Ray;
+class Hasher;
 
 enum class Location {
     kInterior,
@@ -54,14 +58,35 @@ class Shape {
         ///@return double: The time that the intersection occurs at
         double Intersect(const Ray &in_ray) const;
 
+        /// Finds the intersection times for a batch of rays
+        ///@param batch: The rays to check for an intersection
+        ///@param times: Filled with the time of the intersection for each ray (infinity for a miss)
+        void Intersect(const RayBatch &batch, std::vector<double> &times) const {
+            GetKernel().Intersect(batch, times);
+        }
+
         void SetRotation(const Rotation3D& rot) { m_rotation = rot.Inverse(); }
         void SetTranslation(const Translation3D &trans) { m_translation = trans.Inverse(); }
         virtual double Volume() const = 0;
+        /// The registered name of the shape, stable across compilers so it can be used in hashes
+        virtual std::string ShapeName() const = 0;
+        /// Adds the shape to a hash, e.g. for World::Fingerprint. The base adds the type and the
+        /// transform of the shape, derived shapes add their dimensions and nested shapes
+        virtual void Hash(Hasher&) const;
+
+        /// Creates the non-virtual representation of the shape used by the navigator
+        /// Shapes without a dedicated kernel fall back to calling the virtual interface
+        ///@return ShapeKernel: A snapshot of the shape parameters and transform
+        virtual ShapeKernel GetKernel() const { return ShapeKernel(GenericKernel<double>{this}); }
 
     protected:
         Vector3D TransformPoint(const Vector3D&) const;
         Ray TransformRay(const Ray&) const;
+        /// Returns the real roots of a*t^2 + b*t + c = 0 in ascending order, see Kernel::SolveQuadratic
         std::pair<double, double> SolveQuadratic(double, double, double) const;
+        ShapeKernel MakeKernel(ShapeKernel::Variant kernel) const {
+            return {std::move(kernel), m_rotation*m_translation};
+        }
 
     private:
         virtual double IntersectImpl(const Ray&) const = 0;
@@ -132,10 +157,12 @@ class CombinedShape : public Shape, RegistrableShape<CombinedShape> {
             : Shape(rotation, translation), m_left{std::move(left)}, m_right{std::move(right)}, m_op{op} {}
 
         static std::string Name() { return "CombinedShape"; }
+        std::string ShapeName() const override { return Name(); }
         static std::unique_ptr<Shape> Construct(const pugi::xml_node &node);
 
         double SignedDistance(const Vector3D&) const override;
         double Volume() const override;
+        void Hash(Hasher&) const override;
 
     private:
         double IntersectImpl(const Ray&) const override;
@@ -143,6 +170,34 @@ class CombinedShape : public Shape, RegistrableShape<CombinedShape> {
         ShapeBinaryOp m_op;
 };
 
+class ScaledShape : public Shape {
+    public:
+        /// Wraps an existing shape and scales it along each axis before rotating and translating
+        /// Negative scale factors reflect the shape, allowing mirrored copies to share one solid
+        ///@param shape: The shape to be scaled
+        ///@param scale: The scale factors to apply to the shape
+        ///@param rot: The rotation matrix of the scaled shape
+        ///@param trans: The translation of the scaled shape from the origin
+        ScaledShape(std::shared_ptr<Shape> shape, const Scale3D &scale,
+                    const Rotation3D &rotation = Rotation3D(),
+                    const Translation3D &translation = Translation3D());
+
+        static std::string Name() { return "scaledSolid"; }
+        std::string ShapeName() const override { return Name(); }
+
+        double SignedDistance(const Vector3D&) const override;
+        double Volume() const override;
+        void Hash(Hasher&) const override;
+        Shape* GetShape() const { return m_shape.get(); }
+        Vector3D GetScale() const { return m_scale; }
+
+    private:
+        double IntersectImpl(const Ray&) const override;
+        std::shared_ptr<Shape> m_shape;
+        Vector3D m_scale, m_inv_scale;
+        double m_min_scale;
+};
+
 class Box : public Shape, RegistrableShape<Box> {
     public:
         /// Initialize a box with one corner at (-x/2,-y/2,-z/2) and the other at (x/2,y/2,z/2)
@@ -156,10 +211,13 @@ class Box : public Shape, RegistrableShape<Box> {
             : Shape(rotation, translation), m_params{size.X()/2, size.Y()/2, size.Z()/2} {}
 
         static std::string Name() { return "box"; }
+        std::string ShapeName() const override { return Name(); }
         static std::unique_ptr<Shape> Construct(const pugi::xml_node &node);
 
         double SignedDistance(const Vector3D&) const override;
         double Volume() const override { return m_params.X()*m_params.Y()*m_params.Z()*8; }
+        void Hash(Hasher&) const override;
+        ShapeKernel GetKernel() const override { return MakeKernel(BoxKernel<double>{m_params}); }
 
     private:
         double IntersectImpl(const Ray&) const override;
@@ -179,10 +237,13 @@ class Sphere : public Shape, RegistrableShape<Sphere> {
             : Shape(rotation, translation), m_radius{radius} {}
 
         static std::string Name() { return "orb"; }
+        std::string ShapeName() const override { return Name(); }
         static std::unique_ptr<Shape> Construct(const pugi::xml_node &node);
 
         double SignedDistance(const Vector3D&) const override;
         double Volume() const override { return m_radius*m_radius*m_radius*4*M_PI/3.0; }
+        void Hash(Hasher&) const override;
+        ShapeKernel GetKernel() const override { return MakeKernel(SphereKernel<double>{m_radius}); }
 
     private:
         double IntersectImpl(const Ray&) const override;
@@ -191,10 +252,10 @@ class Sphere : public Shape, RegistrableShape<Sphere> {
 
 class Cylinder : public Shape, RegistrableShape<Cylinder> {
     public:
-        /// Initialize a cylinder centered at the origin with the given radius and height
-        /// Then rotates the cylinder, and translates the cylinder
+        /// Initialize a cylinder centered at the origin with the given radius and half height,
+        /// spanning -height <= z <= height. Then rotates the cylinder, and translates the cylinder
         ///@param radius: The radius of the cylinder
-        ///@param height: The height of the cylinder
+        ///@param height: Half of the height of the cylinder
         ///@param rot: The rotation matrix of the cylinder
         ///@param trans: The translation of the cylinder from the origin
         Cylinder(double radius = 1,
@@ -204,10 +265,13 @@ class Cylinder : public Shape, RegistrableShape<Cylinder> {
             : Shape(rotation, translation), m_radius{radius}, m_height{height} {}
 
         static std::string Name() { return "tube"; }
+        std::string ShapeName() const override { return Name(); }
         static std::unique_ptr<Shape> Construct(const pugi::xml_node &node);
 
         double SignedDistance(const Vector3D&) const override;
-        double Volume() const override { return m_radius*m_radius*m_height*M_PI; }
+        double Volume() const override { return 2*m_radius*m_radius*m_height*M_PI; }
+        void Hash(Hasher&) const override;
+        ShapeKernel GetKernel() const override { return MakeKernel(CylinderKernel<double>{m_radius, m_height}); }
 
     private:
         double IntersectImpl(const Ray&) const override;
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "geom/Ray.hh"
+#include "geom/RayBatch.hh"
+#include "geom/Transform3D.hh"
+#include "geom/Vector3D.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace NuGeom {
+
+class Shape;
+
+/// Scalar type used for the candidate search of the navigator. Building with
+/// NUGEOM_SINGLE_PRECISION runs the search in float and refines the closest hits in double
+#ifdef NUGEOM_SINGLE_PRECISION
+using NavigationScalar = float;
+#else
+using NavigationScalar = double;
+#endif
+
+namespace Kernel {
+
+/// Solves a*t^2 + b*t + c = 0 and returns the real roots in ascending order
+/// Uses the sign-aware form q = -(b + sgn(b) sqrt(b^2 - 4ac))/2, t = {q/a, c/q}, which avoids
+/// the cancellation of -b +/- sqrt(b^2 - 4ac) and reduces to the linear root when a = 0
+/// Both roots are infinite if there is no real solution
+template<typename T>
+std::pair<T, T> SolveQuadratic(T a, T b, T c) {
+    constexpr T inf = std::numeric_limits<T>::infinity();
+    const T det = b*b - 4*a*c;
+    const T q = T(-0.5)*(b + std::copysign(std::sqrt(std::max(det, T(0))), b));
+    const T r0 = q/a;
+    const T r1 = c/q;
+    const bool real = det >= 0 && q != 0;
+    return {real ? std::min(r0, r1) : inf, real ? std::max(r0, r1) : inf};
+}
+
+/// Batched form of SolveQuadratic over n coefficients. The loop body has no branches,
+/// so the compiler can vectorize it across the SIMD lanes of the target
+template<typename T>
+void SolveQuadratic(size_t n, const T *a, const T *b, const T *c, T *t0, T *t1) {
+    for(size_t i = 0; i < n; ++i) {
+        const auto roots = SolveQuadratic(a[i], b[i], c[i]);
+        t0[i] = roots.first;
+        t1[i] = roots.second;
+    }
+}
+
+/// Returns the first root in front of the ray origin, or infinity if both are behind it
+template<typename T>
+T FirstPositiveRoot(const std::pair<T, T> &roots) {
+    constexpr T inf = std::numeric_limits<T>::infinity();
+    return roots.first > 0 ? roots.first : roots.second > 0 ? roots.second : inf;
+}
+
+template<typename T>
+T BoxSignedDistance(const BasicVector3D<T> &half, const BasicVector3D<T> &point) {
+    BasicVector3D<T> q = point.Abs() - half;
+    return q.Max().Norm() + std::min(q.MaxComponent(), T(0));
+}
+
+/// Slab test using the cached inverse direction, the signs of the direction pick the near
+/// and far plane along each axis so no divisions or swaps are needed
+template<typename T>
+T BoxIntersect(const BasicVector3D<T> &half, const BasicRay<T> &ray) {
+    constexpr T inf = std::numeric_limits<T>::infinity();
+    const auto origin = ray.Origin();
+    const auto &inv = ray.InverseDirection();
+    const T tx_near = ((ray.Sign(0) ? half.X() : -half.X()) - origin.X())*inv.X();
+    const T tx_far = ((ray.Sign(0) ? -half.X() : half.X()) - origin.X())*inv.X();
+    const T ty_near = ((ray.Sign(1) ? half.Y() : -half.Y()) - origin.Y())*inv.Y();
+    const T ty_far = ((ray.Sign(1) ? -half.Y() : half.Y()) - origin.Y())*inv.Y();
+    const T tz_near = ((ray.Sign(2) ? half.Z() : -half.Z()) - origin.Z())*inv.Z();
+    const T tz_far = ((ray.Sign(2) ? -half.Z() : half.Z()) - origin.Z())*inv.Z();
+
+    const T tmin = std::max(tx_near, std::max(ty_near, tz_near));
+    const T tmax = std::min(tx_far, std::min(ty_far, tz_far));
+    if(tmin > tmax) return inf;
+    return tmin > 0 ? tmin : tmax > 0 ? tmax : inf;
+}
+
+template<typename T>
+T SphereSignedDistance(T radius, const BasicVector3D<T> &point) {
+    return point.Norm() - radius;
+}
+
+template<typename T>
+T SphereIntersect(T radius, const BasicRay<T> &ray) {
+    const T a = ray.Direction()*ray.Direction();
+    const T b = 2*ray.Origin()*ray.Direction();
+    const T c = ray.Origin()*ray.Origin() - radius*radius;
+    return FirstPositiveRoot(SolveQuadratic(a, b, c));
+}
+
+template<typename T>
+T CylinderSignedDistance(T radius, T height, const BasicVector3D<T> &point) {
+    const T qr = std::sqrt(point.X()*point.X() + point.Y()*point.Y()) - radius;
+    const T qz = std::abs(point.Z()) - height;
+    const T outr = std::max(qr, T(0));
+    const T outz = std::max(qz, T(0));
+    return std::sqrt(outr*outr + outz*outz) + std::min(std::max(qr, qz), T(0));
+}
+
+/// Intersects a ray with a solid cylinder along the z-axis spanning -height <= z <= height,
+/// by clipping the interval inside the infinite cylinder against the slab between the endcaps
+template<typename T>
+T CylinderIntersect(T radius, T height, const BasicRay<T> &ray) {
+    constexpr T inf = std::numeric_limits<T>::infinity();
+    const T a = ray.Direction().X()*ray.Direction().X() + ray.Direction().Y()*ray.Direction().Y();
+    const T b = 2*ray.Direction().X()*ray.Origin().X() + 2*ray.Direction().Y()*ray.Origin().Y();
+    const T c = ray.Origin().X()*ray.Origin().X() + ray.Origin().Y()*ray.Origin().Y() - radius*radius;
+    const auto side = SolveQuadratic(a, b, c);
+    // A ray parallel to the axis is either always or never inside the infinite cylinder
+    const bool parallel = a == 0;
+    const T rmin = parallel ? (c <= 0 ? -inf : inf) : side.first;
+    const T rmax = parallel ? (c <= 0 ? inf : -inf) : side.second;
+
+    const T tz1 = (-height - ray.Origin().Z())/ray.Direction().Z();
+    const T tz2 = (height - ray.Origin().Z())/ray.Direction().Z();
+    const auto tz = std::minmax(tz1, tz2);
+    const T tmin = std::max(rmin, tz.first);
+    const T tmax = std::min(rmax, tz.second);
+    if(tmin > tmax) return inf;
+    return tmin > 0 ? tmin : tmax > 0 ? tmax : inf;
+}
+
+double GenericSignedDistance(const Shape*, const Vector3D&);
+double GenericIntersect(const Shape*, const Ray&);
+
+}
+
+template<typename T>
+struct BoxKernel {
+    template<typename U> using Rebind = BoxKernel<U>;
+    template<typename U>
+    static BoxKernel From(const BoxKernel<U> &other) { return {BasicVector3D<T>(other.half)}; }
+
+    BasicVector3D<T> half;
+    T SignedDistance(const BasicVector3D<T> &point) const { return Kernel::BoxSignedDistance(half, point); }
+    T Intersect(const BasicRay<T> &ray) const { return Kernel::BoxIntersect(half, ray); }
+};
+
+template<typename T>
+struct SphereKernel {
+    template<typename U> using Rebind = SphereKernel<U>;
+    template<typename U>
+    static SphereKernel From(const SphereKernel<U> &other) { return {static_cast<T>(other.radius)}; }
+
+    T radius;
+    T SignedDistance(const BasicVector3D<T> &point) const { return Kernel::SphereSignedDistance(radius, point); }
+    T Intersect(const BasicRay<T> &ray) const { return Kernel::SphereIntersect(radius, ray); }
+};
+
+template<typename T>
+struct CylinderKernel {
+    template<typename U> using Rebind = CylinderKernel<U>;
+    template<typename U>
+    static CylinderKernel From(const CylinderKernel<U> &other) {
+        return {static_cast<T>(other.radius), static_cast<T>(other.height)};
+    }
+
+    T radius, height;
+    T SignedDistance(const BasicVector3D<T> &point) const {
+        return Kernel::CylinderSignedDistance(radius, height, point);
+    }
+    T Intersect(const BasicRay<T> &ray) const { return Kernel::CylinderIntersect(radius, height, ray); }
+};
+
+/// Fallback for shapes outside of the closed set (user shapes registered with the ShapeFactory,
+/// boolean and scaled shapes), which goes through the virtual interface of Shape in double precision
+template<typename T>
+struct GenericKernel {
+    template<typename U> using Rebind = GenericKernel<U>;
+    template<typename U>
+    static GenericKernel From(const GenericKernel<U> &other) { return {other.shape}; }
+
+    const Shape *shape{nullptr};
+    T SignedDistance(const BasicVector3D<T> &point) const {
+        return static_cast<T>(Kernel::GenericSignedDistance(shape, Vector3D(point)));
+    }
+    T Intersect(const BasicRay<T> &ray) const {
+        return static_cast<T>(Kernel::GenericIntersect(shape, Ray(ray)));
+    }
+};
+
+/// Non-virtual representation of a shape used by the navigator. The built-in shapes are stored
+/// by value with their local transform, so the hot intersection and distance calls are resolved
+/// with a switch over the variant index and can be inlined into the tracing loop.
+/// The kernel is a snapshot of the shape when it was created, later changes to the shape are not seen.
+template<typename T>
+class BasicShapeKernel {
+    public:
+        using Variant = std::variant<BoxKernel<T>, SphereKernel<T>, CylinderKernel<T>, GenericKernel<T>>;
+
+        BasicShapeKernel() = default;
+        BasicShapeKernel(Variant kernel, const Transform3D &transform = Transform3D())
+            : m_kernel{std::move(kernel)}, m_identity{transform.IsIdentity()} {
+            const auto mat = transform.GetTransform();
+            std::transform(mat.begin(), mat.end(), m_transform.begin(),
+                           [](double elm) { return static_cast<T>(elm); });
+        }
+        /// Converts a kernel between precisions, e.g. to build the single precision navigation kernel
+        template<typename U>
+        explicit BasicShapeKernel(const BasicShapeKernel<U> &other)
+            : m_kernel{std::visit([](const auto &kernel) -> Variant {
+                  using KernelType = typename std::decay_t<decltype(kernel)>::template Rebind<T>;
+                  return KernelType::From(kernel);
+              }, other.m_kernel)}, m_identity{other.m_identity} {
+            std::transform(other.m_transform.begin(), other.m_transform.end(), m_transform.begin(),
+                           [](U elm) { return static_cast<T>(elm); });
+        }
+
+        bool IsGeneric() const { return std::holds_alternative<GenericKernel<T>>(m_kernel); }
+
+        T SignedDistance(const BasicVector3D<T> &in_point) const {
+            const auto point = m_identity ? in_point : TransformPoint(in_point);
+            return std::visit([&point](const auto &kernel) { return kernel.SignedDistance(point); }, m_kernel);
+        }
+
+        T Intersect(const BasicRay<T> &in_ray) const {
+            const auto ray = m_identity ? in_ray : TransformRay(in_ray);
+            const T time = std::visit([&ray](const auto &kernel) { return kernel.Intersect(ray); }, m_kernel);
+            return time <= in_ray.MaxDistance() ? time : std::numeric_limits<T>::infinity();
+        }
+
+        /// Intersects every ray of the batch. The variant is dispatched once for the whole batch,
+        /// so the loop over the rays runs on the concrete kernel
+        void Intersect(const BasicRayBatch<T> &batch, std::vector<T> &times) const {
+            times.resize(batch.Size());
+            std::visit([&](const auto &kernel) {
+                for(size_t i = 0; i < batch.Size(); ++i) {
+                    const auto in_ray = batch.Get(i);
+                    const auto ray = m_identity ? in_ray : TransformRay(in_ray);
+                    const T time = kernel.Intersect(ray);
+                    times[i] = time <= in_ray.MaxDistance() ? time : std::numeric_limits<T>::infinity();
+                }
+            }, m_kernel);
+        }
+
+    private:
+        template<typename U> friend class BasicShapeKernel;
+
+        BasicVector3D<T> TransformPoint(const BasicVector3D<T> &point) const {
+            return {m_transform[0]*point.X() + m_transform[1]*point.Y() + m_transform[2]*point.Z() + m_transform[3],
+                    m_transform[4]*point.X() + m_transform[5]*point.Y() + m_transform[6]*point.Z() + m_transform[7],
+                    m_transform[8]*point.X() + m_transform[9]*point.Y() + m_transform[10]*point.Z() + m_transform[11]};
+        }
+        BasicVector3D<T> TransformDirection(const BasicVector3D<T> &dir) const {
+            return {m_transform[0]*dir.X() + m_transform[1]*dir.Y() + m_transform[2]*dir.Z(),
+                    m_transform[4]*dir.X() + m_transform[5]*dir.Y() + m_transform[6]*dir.Z(),
+                    m_transform[8]*dir.X() + m_transform[9]*dir.Y() + m_transform[10]*dir.Z()};
+        }
+        BasicRay<T> TransformRay(const BasicRay<T> &ray) const {
+            // The local transform of a shape is rigid, so the direction stays normalized
+            return {TransformPoint(ray.Origin()), TransformDirection(ray.Direction()), false, ray.MaxDistance()};
+        }
+
+        Variant m_kernel{GenericKernel<T>{}};
+        std::array<T, 12> m_transform{};
+        bool m_identity{true};
+};
+
+using ShapeKernel = BasicShapeKernel<double>;
+using ShapeKernelF = BasicShapeKernel<float>;
+
+}
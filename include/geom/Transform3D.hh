@@ -1,6 +1,11 @@
 #pragma once
 
+#include "geom/Ray.hh"
+#include "geom/Utilities.hh"
 #include "geom/Vector3D.hh"
+
+#include <array>
+#include <cstddef>
 #include <string>
 
 namespace NuGeom {
@@ -8,24 +13,65 @@ namespace NuGeom {
 class Rotation3D;
 class Translation3D;
 class Scale3D;
-class Ray;
 
 class Transform3D {
     public:
-        Transform3D() : m_mat{identity} {}
-        Transform3D(const std::array<double, 12>& transform) : m_mat{transform} {}
-        Transform3D(double, double, double, double,
-                    double, double, double, double,
-                    double, double, double, double);
-        Transform3D(const Rotation3D&, const Translation3D&);
-        Transform3D(const Transform3D&) = default;
-        Transform3D &operator=(const Transform3D&) = default;
-        virtual ~Transform3D() = default;
+        /// Structure of the transform, used to skip the parts of the matrix product that are not needed.
+        /// Rotation covers any orthonormal linear part (including reflections), General anything else
+        enum class Kind { Identity, Translation, Rotation, RotationTranslation, General };
+
+        constexpr Transform3D() : m_mat{identity}, m_kind{Kind::Identity} {}
+        constexpr Transform3D(const std::array<double, 12>& transform) : m_mat{transform}, m_kind{Classify(m_mat)} {}
+        constexpr Transform3D(double xx, double xy, double xz, double tx,
+                              double yx, double yy, double yz, double ty,
+                              double zx, double zy, double zz, double tz)
+            : m_mat{xx, xy, xz, tx, yx, yy, yz, ty, zx, zy, zz, tz}, m_kind{Classify(m_mat)} {}
+        constexpr Transform3D(const Rotation3D&, const Translation3D&);
+        constexpr Transform3D(const Transform3D&) = default;
+        constexpr Transform3D &operator=(const Transform3D&) = default;
 
-        virtual Vector3D Apply(const Vector3D&) const;
+        constexpr Vector3D Apply(const Vector3D &point) const {
+            switch(m_kind) {
+                case Kind::Identity:
+                    return point;
+                case Kind::Translation:
+                    return {point.X() + m_mat[3], point.Y() + m_mat[7], point.Z() + m_mat[11]};
+                case Kind::Rotation:
+                    return ApplyDirection(point);
+                default:
+                    return ApplyDirection(point) + Vector3D{m_mat[3], m_mat[7], m_mat[11]};
+            }
+        }
+        /// Applies only the linear part of the transform, i.e. transforms a direction
+        constexpr Vector3D ApplyDirection(const Vector3D &dir) const {
+            if(m_kind == Kind::Identity || m_kind == Kind::Translation) return dir;
+            return {m_mat[0]*dir.X() + m_mat[1]*dir.Y() + m_mat[2]*dir.Z(),
+                    m_mat[4]*dir.X() + m_mat[5]*dir.Y() + m_mat[6]*dir.Z(),
+                    m_mat[8]*dir.X() + m_mat[9]*dir.Y() + m_mat[10]*dir.Z()};
+        }
+        /// Transforms the origin as a point and the direction as a direction. General transforms
+        /// change lengths along the ray, so the direction is renormalized and the max distance is
+        /// rescaled. A time t found along the transformed ray is then t/length along the input ray
+        ///@param ray: The ray to transform
+        ///@param length: Set to the length of the transformed direction, 1 for rigid transforms
+        Ray Apply(const Ray &ray, double &length) const {
+            const auto direction = ApplyDirection(ray.Direction());
+            if(m_kind != Kind::General) {
+                length = 1;
+                return {Apply(ray.Origin()), direction, false, ray.MaxDistance()};
+            }
+            length = direction.Norm();
+            return {Apply(ray.Origin()), direction/length, false, ray.MaxDistance()*length};
+        }
+        /// Transforms a ray where the times along it are not needed in the original frame,
+        /// or the transform is known to be rigid. See Apply(const Ray&, double&)
+        Ray Apply(const Ray &ray) const {
+            double length{};
+            return Apply(ray, length);
+        }
 
-        Transform3D Inverse() const;
-        Transform3D operator*(const Transform3D&) const;
+        constexpr Transform3D Inverse() const;
+        constexpr Transform3D operator*(const Transform3D&) const;
 
         void Decompose(Scale3D&, Rotation3D&, Translation3D&) const;
 
@@ -39,17 +85,21 @@ class Transform3D {
             os << output << ")";
             return os;
         }
-        std::array<double, 12> GetTransform() const { return m_mat; }
+        constexpr std::array<double, 12> GetTransform() const { return m_mat; }
+        constexpr Kind GetKind() const { return m_kind; }
         static Vector3D ApplyPoint(const Vector3D&, const Transform3D&);
         static Ray ApplyRay(const Ray&, const Transform3D&);
         static Ray ApplyRay(const Ray&, const Translation3D&, const Rotation3D&);
         static Ray TranslateRay(const Ray &ray, const Translation3D &trans);
-        bool IsIdentity() const { return m_mat == identity; }
+        constexpr bool IsIdentity() const { return m_kind == Kind::Identity; }
         constexpr std::array<double, 12> Identity() const { return identity; }
 
     protected:
-        void SetTransform(const std::array<double, 12> &trans) { m_mat = trans; }
+        constexpr void SetTransform(const std::array<double, 12> &trans) { m_mat = trans; m_kind = Classify(m_mat); }
+        static constexpr Kind Classify(const std::array<double, 12>&);
+        static void WarnSingular();
         std::array<double, 12> m_mat;
+        Kind m_kind;
         static constexpr std::array<double, 12> identity{1, 0, 0, 0,
                                                          0, 1, 0, 0,
                                                          0, 0, 1, 0};
@@ -57,77 +107,199 @@ class Transform3D {
 
 class Scale3D : public Transform3D {
     public:
-        Scale3D() = default;
-        Scale3D(const Vector3D&);
-        Scale3D(double x, double y, double z);
+        constexpr Scale3D() = default;
+        constexpr Scale3D(const Vector3D &vec) : Scale3D(vec.X(), vec.Y(), vec.Z()) {}
+        constexpr Scale3D(double x, double y, double z) : Transform3D(x, 0, 0, 0,
+                                                                      0, y, 0, 0,
+                                                                      0, 0, z, 0) {}
+        constexpr Scale3D(const Transform3D &scale) : Transform3D(scale) {}
+
+        /// Scale factors along each axis, negative values are reflections
+        constexpr Vector3D Factors() const { return {m_mat[0], m_mat[5], m_mat[10]}; }
 };
 
 class ScaleX3D : public Scale3D {
     public:
-        ScaleX3D(double x) : Scale3D(x, 0, 0) {}
+        constexpr ScaleX3D(double x) : Scale3D(x, 1, 1) {}
 };
 
 class ScaleY3D : public Scale3D {
     public:
-        ScaleY3D(double y) : Scale3D(0, y, 0) {}
+        constexpr ScaleY3D(double y) : Scale3D(1, y, 1) {}
 };
 
 class ScaleZ3D : public Scale3D {
     public:
-        ScaleZ3D(double z) : Scale3D(0, 0, z) {}
+        constexpr ScaleZ3D(double z) : Scale3D(1, 1, z) {}
 };
 
 class Rotation3D : public Transform3D {
     public:
-        Rotation3D() = default;
-        Rotation3D(const Vector3D&, double);
-        Rotation3D(const Transform3D&);
+        constexpr Rotation3D() = default;
+        /// Rotation by angle (in radians) around the axis, usable in constant expressions
+        constexpr Rotation3D(const Vector3D &vec, double angle) : Transform3D(AxisAngle(vec, angle)) {}
+        constexpr Rotation3D(const Transform3D &rot) : Transform3D(rot) {}
+
+    private:
+        static constexpr std::array<double, 12> AxisAngle(const Vector3D &vec, double angle) {
+            // Ensure the vector is a unit vector
+            const double norm = Math::Sqrt(vec.Norm2());
+            const Vector3D axis{vec.X()/norm, vec.Y()/norm, vec.Z()/norm};
+            const double cosa = Math::Cos(angle);
+            const double sina = Math::Sin(angle);
+            return {cosa+axis.X()*axis.X()*(1-cosa), axis.X()*axis.Y()*(1-cosa) - axis.Z()*sina,
+                    axis.X()*axis.Z()*(1-cosa)+axis.Y()*sina, 0,
+                    axis.Y()*axis.X()*(1-cosa)+axis.Z()*sina, cosa+axis.Y()*axis.Y()*(1-cosa),
+                    axis.Y()*axis.Z()*(1-cosa)-axis.X()*sina, 0,
+                    axis.Z()*axis.X()*(1-cosa)-axis.Y()*sina, axis.Z()*axis.Y()*(1-cosa)+axis.X()*sina,
+                    cosa+axis.Z()*axis.Z()*(1-cosa), 0};
+        }
 };
 
 class RotationX3D : public Rotation3D {
     public:
-        RotationX3D(double theta) : Rotation3D({1, 0, 0}, theta) {}
+        constexpr RotationX3D(double theta) : Rotation3D({1, 0, 0}, theta) {}
 };
 
 class RotationY3D : public Rotation3D {
     public:
-        RotationY3D(double theta) : Rotation3D({0, 1, 0}, theta) {}
+        constexpr RotationY3D(double theta) : Rotation3D({0, 1, 0}, theta) {}
 };
 
 class RotationZ3D : public Rotation3D {
     public:
-        RotationZ3D(double theta) : Rotation3D({0, 0, 1}, theta) {}
+        constexpr RotationZ3D(double theta) : Rotation3D({0, 0, 1}, theta) {}
 };
 
 class Translation3D : public Transform3D {
     public:
-        Translation3D() = default;
-        Translation3D(const Vector3D &vec) : Transform3D(1, 0, 0, vec.X(),
-                                                         0, 1, 0, vec.Y(),
-                                                         0, 0, 1, vec.Z()) {}
-        Translation3D(double x, double y, double z) : Transform3D(1, 0, 0, x,
-                                                                  0, 1, 0, y,
-                                                                  0, 0, 1, z) {}
-        Translation3D(const Transform3D&);
-
-        Vector3D Apply(const Vector3D &point) const override {
-            return {point.X() + m_mat[3], point.Y() + m_mat[7], point.Z() + m_mat[11]};
-        }
+        constexpr Translation3D() = default;
+        constexpr Translation3D(const Vector3D &vec) : Transform3D(1, 0, 0, vec.X(),
+                                                                   0, 1, 0, vec.Y(),
+                                                                   0, 0, 1, vec.Z()) {}
+        constexpr Translation3D(double x, double y, double z) : Transform3D(1, 0, 0, x,
+                                                                            0, 1, 0, y,
+                                                                            0, 0, 1, z) {}
+        constexpr Translation3D(const Transform3D &trans) : Transform3D(trans) {}
 };
 
 class TranslationX3D : public Translation3D {
     public:
-        TranslationX3D(double x) : Translation3D(x, 0, 0) {}
+        constexpr TranslationX3D(double x) : Translation3D(x, 0, 0) {}
 };
 
 class TranslationY3D : public Translation3D {
     public:
-        TranslationY3D(double y) : Translation3D(0, y, 0) {}
+        constexpr TranslationY3D(double y) : Translation3D(0, y, 0) {}
 };
 
 class TranslationZ3D : public Translation3D {
     public:
-        TranslationZ3D(double z) : Translation3D(0, 0, z) {}
+        constexpr TranslationZ3D(double z) : Translation3D(0, 0, z) {}
+};
+
+constexpr Transform3D::Transform3D(const Rotation3D &rot, const Translation3D &trans)
+    : Transform3D(rot.m_mat[0], rot.m_mat[1], rot.m_mat[2], trans.m_mat[3],
+                  rot.m_mat[4], rot.m_mat[5], rot.m_mat[6], trans.m_mat[7],
+                  rot.m_mat[8], rot.m_mat[9], rot.m_mat[10], trans.m_mat[11]) {}
+
+constexpr Transform3D::Kind Transform3D::Classify(const std::array<double, 12> &mat) {
+    constexpr double tolerance = 1e-12;
+    const bool has_translation = mat[3] != 0 || mat[7] != 0 || mat[11] != 0;
+    const bool has_linear = mat[0] != 1 || mat[1] != 0 || mat[2] != 0
+                         || mat[4] != 0 || mat[5] != 1 || mat[6] != 0
+                         || mat[8] != 0 || mat[9] != 0 || mat[10] != 1;
+    if(!has_linear) return has_translation ? Kind::Translation : Kind::Identity;
+
+    // Check if the columns of the linear part are orthonormal
+    for(size_t i = 0; i < 3; ++i) {
+        for(size_t j = i; j < 3; ++j) {
+            double dot = mat[i]*mat[j] + mat[4+i]*mat[4+j] + mat[8+i]*mat[8+j];
+            if(Math::Abs(dot - (i == j ? 1 : 0)) > tolerance) return Kind::General;
+        }
+    }
+    return has_translation ? Kind::RotationTranslation : Kind::Rotation;
+}
+
+constexpr Transform3D Transform3D::Inverse() const {
+    switch(m_kind) {
+        case Kind::Identity:
+            return *this;
+        case Kind::Translation:
+            return {1, 0, 0, -m_mat[3],
+                    0, 1, 0, -m_mat[7],
+                    0, 0, 1, -m_mat[11]};
+        case Kind::Rotation:
+        case Kind::RotationTranslation:
+            // The inverse of an orthonormal matrix is its transpose
+            return {m_mat[0], m_mat[4], m_mat[8], -m_mat[0]*m_mat[3]-m_mat[4]*m_mat[7]-m_mat[8]*m_mat[11],
+                    m_mat[1], m_mat[5], m_mat[9], -m_mat[1]*m_mat[3]-m_mat[5]*m_mat[7]-m_mat[9]*m_mat[11],
+                    m_mat[2], m_mat[6], m_mat[10], -m_mat[2]*m_mat[3]-m_mat[6]*m_mat[7]-m_mat[10]*m_mat[11]};
+        case Kind::General:
+            break;
+    }
+
+    double detxx = m_mat[5]*m_mat[10] - m_mat[6]*m_mat[9];
+    double detxy = m_mat[6]*m_mat[8] - m_mat[4]*m_mat[10];
+    double detxz = m_mat[4]*m_mat[9] - m_mat[5]*m_mat[8];
+    double det = m_mat[0]*detxx + m_mat[1]*detxy + m_mat[2]*detxz;
+    if(det == 0) {
+        WarnSingular();
+        return Transform3D();
+    }
+    det = 1.0/det;
+    detxx *= det;
+    detxy *= det;
+    detxz *= det;
+    double detyx = (m_mat[2]*m_mat[9] - m_mat[1]*m_mat[10])*det;
+    double detyy = (m_mat[0]*m_mat[10] - m_mat[2]*m_mat[8])*det;
+    double detyz = (m_mat[1]*m_mat[8] - m_mat[0]*m_mat[9])*det;
+    double detzx = (m_mat[1]*m_mat[6] - m_mat[2]*m_mat[5])*det;
+    double detzy = (m_mat[2]*m_mat[4] - m_mat[0]*m_mat[6])*det;
+    double detzz = (m_mat[0]*m_mat[5] - m_mat[1]*m_mat[4])*det;
+    return {detxx, detyx, detzx, -detxx*m_mat[3]-detyx*m_mat[7]-detzx*m_mat[11],
+            detxy, detyy, detzy, -detxy*m_mat[3]-detyy*m_mat[7]-detzy*m_mat[11],
+            detxz, detyz, detzz, -detxz*m_mat[3]-detyz*m_mat[7]-detzz*m_mat[11]};
+}
+
+constexpr Transform3D Transform3D::operator*(const Transform3D &other) const {
+    return {m_mat[0]*other.m_mat[0] + m_mat[1]*other.m_mat[4] + m_mat[2]*other.m_mat[8],
+            m_mat[0]*other.m_mat[1] + m_mat[1]*other.m_mat[5] + m_mat[2]*other.m_mat[9],
+            m_mat[0]*other.m_mat[2] + m_mat[1]*other.m_mat[6] + m_mat[2]*other.m_mat[10],
+            m_mat[0]*other.m_mat[3] + m_mat[1]*other.m_mat[7] + m_mat[2]*other.m_mat[11] + m_mat[3],
+
+            m_mat[4]*other.m_mat[0] + m_mat[5]*other.m_mat[4] + m_mat[6]*other.m_mat[8],
+            m_mat[4]*other.m_mat[1] + m_mat[5]*other.m_mat[5] + m_mat[6]*other.m_mat[9],
+            m_mat[4]*other.m_mat[2] + m_mat[5]*other.m_mat[6] + m_mat[6]*other.m_mat[10],
+            m_mat[4]*other.m_mat[3] + m_mat[5]*other.m_mat[7] + m_mat[6]*other.m_mat[11] + m_mat[7],
+
+            m_mat[8]*other.m_mat[0] + m_mat[9]*other.m_mat[4] + m_mat[10]*other.m_mat[8],
+            m_mat[8]*other.m_mat[1] + m_mat[9]*other.m_mat[5] + m_mat[10]*other.m_mat[9],
+            m_mat[8]*other.m_mat[2] + m_mat[9]*other.m_mat[6] + m_mat[10]*other.m_mat[10],
+            m_mat[8]*other.m_mat[3] + m_mat[9]*other.m_mat[7] + m_mat[10]*other.m_mat[11] + m_mat[11]};
+}
+
+/// Transform stored together with its inverse, for placements that are applied
+/// in both directions on every navigation step
+class CachedTransform3D {
+    public:
+        CachedTransform3D() = default;
+        CachedTransform3D(const Transform3D &transform)
+            : m_forward{transform}, m_inverse{transform.Inverse()} {}
+
+        const Transform3D& Forward() const { return m_forward; }
+        const Transform3D& Inverse() const { return m_inverse; }
+        Transform3D::Kind GetKind() const { return m_forward.GetKind(); }
+        bool IsIdentity() const { return m_forward.IsIdentity(); }
+
+        Vector3D Apply(const Vector3D &point) const { return m_forward.Apply(point); }
+        Vector3D ApplyInverse(const Vector3D &point) const { return m_inverse.Apply(point); }
+        Ray Apply(const Ray &ray) const { return m_forward.Apply(ray); }
+        Ray ApplyInverse(const Ray &ray) const { return m_inverse.Apply(ray); }
+        Ray Apply(const Ray &ray, double &length) const { return m_forward.Apply(ray, length); }
+
+    private:
+        Transform3D m_forward, m_inverse;
 };
 
 }
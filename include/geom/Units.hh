@@ -4,5 +4,14 @@ namespace NuGeom {
 namespace Units {
     constexpr double MeV = 1.0;
     constexpr double amu = 931.5*MeV;
+
+    // Lengths are stored in cm
+    constexpr double cm = 1.0;
+    constexpr double mm = 0.1*cm;
+    constexpr double m = 100*cm;
+
+    // Angles are stored in radians
+    constexpr double rad = 1.0;
+    constexpr double deg = 3.14159265358979323846/180*rad;
 }
 }
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
 
 namespace NuGeom {
 
@@ -9,4 +13,120 @@ bool is_close(const T &a, const T &b, const T &eps = T(1e-8)) {
     return std::abs(a - b) < eps;
 }
 
+/// 64 bit FNV-1a hash, used to fingerprint geometries and settings for the on disk caches
+class Hasher {
+    public:
+        Hasher& Add(const void *data, size_t size) {
+            const auto *bytes = static_cast<const unsigned char*>(data);
+            for(size_t i = 0; i < size; ++i) {
+                m_hash ^= bytes[i];
+                m_hash *= 0x100000001b3;
+            }
+            return *this;
+        }
+        template<typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+        Hasher& Add(T value) { return Add(&value, sizeof(T)); }
+        Hasher& Add(const std::string &value) { return Add(value.size()).Add(value.data(), value.size()); }
+
+        uint64_t Value() const { return m_hash; }
+
+    private:
+        uint64_t m_hash{0xcbf29ce484222325};
+};
+
+/// constexpr versions of the math functions needed to build vectors and transforms at compile time.
+/// At run time they forward to <cmath> when the compiler can tell the two apart, so runtime results
+/// are unchanged. Otherwise the series are used, which are slower and only meant for setup code
+namespace Math {
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define NUGEOM_HAS_CONSTANT_EVALUATED
+#endif
+#endif
+
+constexpr bool IsConstantEvaluated() {
+#ifdef NUGEOM_HAS_CONSTANT_EVALUATED
+    return __builtin_is_constant_evaluated();
+#else
+    return true;
+#endif
+}
+
+template<typename T>
+constexpr T Abs(T x) { return x < 0 ? -x : x; }
+
+/// Newton iteration, exact to the last bit for the well scaled inputs used for axes and norms
+template<typename T>
+constexpr T Sqrt(T x) {
+    if(!IsConstantEvaluated()) return std::sqrt(x);
+    if(!(x > 0)) return x == 0 ? x : std::numeric_limits<T>::quiet_NaN();
+    if(x == std::numeric_limits<T>::infinity()) return x;
+    T guess = x > 1 ? x : T(1);
+    for(int i = 0; i < 2048; ++i) {
+        T next = (guess + x/guess)/2;
+        if(next >= guess) break;
+        guess = next;
+    }
+    return guess;
+}
+
+namespace detail {
+
+/// Taylor series on the reduced range [-pi/4, pi/4]
+constexpr double SinReduced(double x) {
+    double term = x, sum = x;
+    for(int n = 1; n < 12; ++n) {
+        term *= -x*x/((2*n)*(2*n+1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double CosReduced(double x) {
+    double term = 1, sum = 1;
+    for(int n = 1; n < 12; ++n) {
+        term *= -x*x/((2*n-1)*(2*n));
+        sum += term;
+    }
+    return sum;
+}
+
+/// Splits x = k*pi/2 + r with |r| <= pi/4, using a two part pi/2 to keep r accurate
+constexpr double ReduceQuadrant(double x, long long &quadrant) {
+    constexpr double pio2_hi = 1.5707963267948966;
+    constexpr double pio2_lo = 6.123233995736766e-17;
+    const double k = static_cast<double>(static_cast<long long>(x/pio2_hi + (x < 0 ? -0.5 : 0.5)));
+    quadrant = static_cast<long long>(k);
+    return (x - k*pio2_hi) - k*pio2_lo;
+}
+
+}
+
+constexpr double Sin(double x) {
+    if(!IsConstantEvaluated()) return std::sin(x);
+    long long quadrant = 0;
+    const double r = detail::ReduceQuadrant(x, quadrant);
+    switch(((quadrant % 4) + 4) % 4) {
+        case 0: return detail::SinReduced(r);
+        case 1: return detail::CosReduced(r);
+        case 2: return -detail::SinReduced(r);
+        default: return -detail::CosReduced(r);
+    }
+}
+
+constexpr double Cos(double x) {
+    if(!IsConstantEvaluated()) return std::cos(x);
+    long long quadrant = 0;
+    const double r = detail::ReduceQuadrant(x, quadrant);
+    switch(((quadrant % 4) + 4) % 4) {
+        case 0: return detail::CosReduced(r);
+        case 1: return -detail::SinReduced(r);
+        case 2: return -detail::CosReduced(r);
+        default: return detail::SinReduced(r);
+    }
+}
+
+}
+
 }
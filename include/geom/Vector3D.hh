@@ -1,110 +1,147 @@
 #pragma once
 
+#include "geom/Utilities.hh"
+
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
 
 namespace NuGeom {
 
-class Vector3D {
+/// Three vector templated on the scalar type. Vector3D (double) is used throughout the geometry,
+/// while Vector3F (float) is used by the single precision navigation kernels.
+/// The components are stored in a four-wide array whose last lane is kept at zero, so the
+/// element-wise operators below map onto SSE registers (one for float, two for double) and
+/// chains like o + t*d compile to a few vector instructions. The alignment is capped at 16 bytes,
+/// larger alignments change how the vector is passed by value between translation units
+template<typename T>
+class BasicVector3D {
     public:
-        Vector3D() : m_vec{} {}
-        constexpr Vector3D(double x, double y, double z) : m_vec{x, y, z} {}
-        Vector3D(std::array<double, 3> vec) : m_vec{vec} {}
-        Vector3D(const Vector3D&) = default;
-        Vector3D(Vector3D&&) = default;
+        using value_type = T;
+
+        constexpr BasicVector3D() : m_vec{} {}
+        constexpr BasicVector3D(T x, T y, T z) : m_vec{x, y, z, 0} {}
+        constexpr BasicVector3D(std::array<T, 3> vec) : m_vec{vec[0], vec[1], vec[2], 0} {}
+        BasicVector3D(const BasicVector3D&) = default;
+        BasicVector3D(BasicVector3D&&) = default;
+        template<typename U>
+        constexpr explicit BasicVector3D(const BasicVector3D<U> &other)
+            : m_vec{static_cast<T>(other.X()), static_cast<T>(other.Y()), static_cast<T>(other.Z()), 0} {}
 
-        Vector3D& operator=(const Vector3D&) = default;
-        Vector3D& operator=(Vector3D&&) = default;
+        BasicVector3D& operator=(const BasicVector3D&) = default;
+        BasicVector3D& operator=(BasicVector3D&&) = default;
 
         // const access
-        const double& X() const { return m_vec[0]; }
-        const double& Y() const { return m_vec[1]; }
-        const double& Z() const { return m_vec[2]; }
-        const double& R() const { return m_vec[0]; }
-        const double& G() const { return m_vec[1]; }
-        const double& B() const { return m_vec[2]; }
+        constexpr const T& X() const { return m_vec[0]; }
+        constexpr const T& Y() const { return m_vec[1]; }
+        constexpr const T& Z() const { return m_vec[2]; }
+        constexpr const T& R() const { return m_vec[0]; }
+        constexpr const T& G() const { return m_vec[1]; }
+        constexpr const T& B() const { return m_vec[2]; }
 
         // non-const access
-        double& X() { return m_vec[0]; }
-        double& Y() { return m_vec[1]; }
-        double& Z() { return m_vec[2]; }
-        double& R() { return m_vec[0]; }
-        double& G() { return m_vec[1]; }
-        double& B() { return m_vec[2]; }
+        constexpr T& X() { return m_vec[0]; }
+        constexpr T& Y() { return m_vec[1]; }
+        constexpr T& Z() { return m_vec[2]; }
+        constexpr T& R() { return m_vec[0]; }
+        constexpr T& G() { return m_vec[1]; }
+        constexpr T& B() { return m_vec[2]; }
 
         // Functions
-        double Dot(const Vector3D&) const;
-        Vector3D Cross(const Vector3D&) const;
-        double Norm2() const { return Dot(*this); }
-        double Norm() const { return sqrt(Norm2()); }
-        Vector3D Unit() const;
-        Vector3D Abs() const { return {std::abs(X()), std::abs(Y()), std::abs(Z())}; }
-        Vector3D Max(const Vector3D& = Vector3D()) const;
-        double MaxComponent() const;
+        constexpr T Dot(const BasicVector3D &other) const {
+            return m_vec[0]*other.m_vec[0] + m_vec[1]*other.m_vec[1] + m_vec[2]*other.m_vec[2];
+        }
+        constexpr BasicVector3D Cross(const BasicVector3D &other) const {
+            return {m_vec[1]*other.m_vec[2] - m_vec[2]*other.m_vec[1],
+                    m_vec[2]*other.m_vec[0] - m_vec[0]*other.m_vec[2],
+                    m_vec[0]*other.m_vec[1] - m_vec[1]*other.m_vec[0]};
+        }
+        constexpr T Norm2() const { return Dot(*this); }
+        T Norm() const { return std::sqrt(Norm2()); }
+        BasicVector3D Unit() const {
+            T norm = Norm();
+            return {m_vec[0]/norm, m_vec[1]/norm, m_vec[2]/norm};
+        }
+        constexpr BasicVector3D Abs() const {
+            BasicVector3D result;
+            for(size_t i = 0; i < width; ++i) result.m_vec[i] = Math::Abs(m_vec[i]);
+            return result;
+        }
+        constexpr BasicVector3D Max(const BasicVector3D &other = BasicVector3D()) const {
+            BasicVector3D result;
+            for(size_t i = 0; i < width; ++i) result.m_vec[i] = std::max(m_vec[i], other.m_vec[i]);
+            return result;
+        }
+        constexpr T MaxComponent() const { return std::max(X(), std::max(Y(), Z())); }
 
         // Operators
-        friend Vector3D operator*(double, const Vector3D&);
-        friend Vector3D operator/(const Vector3D&, double);
-        friend Vector3D operator/(double, const Vector3D&);
-        const double& operator[](size_t i) const { return m_vec[i]; }
-        double& operator[](size_t i) { return m_vec[i]; }
-   
-        bool operator==(const Vector3D &other) const {
-            return m_vec == other.m_vec;
-        }
-        bool operator!=(const Vector3D &other) const {
-            return !(*this == other);
+        friend constexpr BasicVector3D operator*(T scale, const BasicVector3D &vec) {
+            return BasicVector3D{vec} *= scale;
         }
+        friend constexpr BasicVector3D operator/(const BasicVector3D &vec, T scale) {
+            return BasicVector3D{vec} /= scale;
+        }
+        friend constexpr BasicVector3D operator/(T scale, const BasicVector3D &vec) {
+            return {scale / vec.X(), scale / vec.Y(), scale / vec.Z()};
+        }
+        constexpr const T& operator[](size_t i) const { return m_vec[i]; }
+        constexpr T& operator[](size_t i) { return m_vec[i]; }
 
-        Vector3D& operator*=(double scale) {
-            m_vec[0] *= scale;
-            m_vec[1] *= scale;
-            m_vec[2] *= scale;
+        constexpr bool operator==(const BasicVector3D &other) const {
+            return m_vec[0] == other.m_vec[0] && m_vec[1] == other.m_vec[1] && m_vec[2] == other.m_vec[2];
+        }
+        constexpr bool operator!=(const BasicVector3D &other) const {
+            return !(*this == other);
+        }
 
+        constexpr BasicVector3D& operator*=(T scale) {
+            for(size_t i = 0; i < width; ++i) m_vec[i] *= scale;
             return *this;
         }
-        Vector3D& operator/=(double scale) {
-            return *this *= 1.0/scale;
+        constexpr BasicVector3D& operator/=(T scale) {
+            return *this *= T(1)/scale;
         }
-        Vector3D& operator+=(const Vector3D &other) {
-            m_vec[0] += other.m_vec[0];
-            m_vec[1] += other.m_vec[1];
-            m_vec[2] += other.m_vec[2];
-
+        constexpr BasicVector3D& operator+=(const BasicVector3D &other) {
+            for(size_t i = 0; i < width; ++i) m_vec[i] += other.m_vec[i];
             return *this;
         }
-        Vector3D& operator-=(const Vector3D &other) {
-            return *this += -other;
+        constexpr BasicVector3D& operator-=(const BasicVector3D &other) {
+            for(size_t i = 0; i < width; ++i) m_vec[i] -= other.m_vec[i];
+            return *this;
         }
-        Vector3D operator*(double scale) const {
-            return Vector3D{*this} *= scale;
+        constexpr BasicVector3D operator*(T scale) const {
+            return BasicVector3D{*this} *= scale;
         }
-        double operator*(const Vector3D &other) const {
+        constexpr T operator*(const BasicVector3D &other) const {
             return Dot(other);
         }
-        Vector3D operator+(const Vector3D &other) const {
-            return Vector3D{*this} += other;
+        constexpr BasicVector3D operator+(const BasicVector3D &other) const {
+            return BasicVector3D{*this} += other;
         }
-        Vector3D operator-(const Vector3D &other) const {
-            return Vector3D{*this} -= other;
+        constexpr BasicVector3D operator-(const BasicVector3D &other) const {
+            return BasicVector3D{*this} -= other;
         }
-        Vector3D operator-() const {
-            return {-m_vec[0], -m_vec[1], -m_vec[2]};
+        constexpr BasicVector3D operator-() const {
+            BasicVector3D result;
+            for(size_t i = 0; i < width; ++i) result.m_vec[i] = -m_vec[i];
+            return result;
         }
 
         template<typename OStream>
-        friend OStream& operator<<(OStream &os, const Vector3D &vec) {
+        friend OStream& operator<<(OStream &os, const BasicVector3D &vec) {
             os << "Vector3D(" << vec.X() << ", " << vec.Y() << ", " << vec.Z() << ")";
             return os;
         }
 
     private:
-        std::array<double, 3> m_vec;
+        static constexpr size_t width = 4;
+        static constexpr size_t alignment = std::min<size_t>(width*sizeof(T), 16);
+        alignas(alignment) std::array<T, width> m_vec;
 };
 
-Vector3D operator*(double, const Vector3D&);
-Vector3D operator/(const Vector3D&, double);
-Vector3D operator/(double, const Vector3D&);
+using Vector3D = BasicVector3D<double>;
+using Vector3F = BasicVector3D<float>;
 
 static constexpr Vector3D UnitX = Vector3D(1, 0, 0);
 static constexpr Vector3D UnitY = Vector3D(0, 1, 0);
@@ -1,12 +1,12 @@
 #pragma once
 
+#include "geom/Vector3D.hh"
+
 #include <array>
 #include <cmath>
 
 namespace NuGeom {
 
-class Vector3D;
-
 namespace Visualization {
 
 class Vector4D {
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "geom/MaterialTable.hh"
+#include "geom/Vector3D.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace NuGeom {
+
+struct InteractionVertices;
+
+/// Generated interaction vertices stored as one array per quantity, as written to and read
+/// from the binary vertex files
+struct VertexColumns {
+    std::vector<double> x, y, z;
+    std::vector<MaterialId> material;
+    /// Atomic and mass number of the target element
+    std::vector<uint32_t> Z, A;
+    std::vector<double> weight;
+    /// Index of the neutrino in the flux source
+    std::vector<uint64_t> event;
+
+    void Add(const Vector3D &position, MaterialId material_id, uint32_t atomic_number, uint32_t mass_number,
+             double vertex_weight, uint64_t event_number) {
+        x.push_back(position.X());
+        y.push_back(position.Y());
+        z.push_back(position.Z());
+        material.push_back(material_id);
+        Z.push_back(atomic_number);
+        A.push_back(mass_number);
+        weight.push_back(vertex_weight);
+        event.push_back(event_number);
+    }
+    void Reserve(size_t size);
+    void Clear();
+    size_t Size() const { return event.size(); }
+};
+
+/// Writes interaction vertices to a binary file with a column layout. The file starts with the
+/// magic "NUGEOMVX", the format version and the schema: the number of columns, then the name
+/// and numpy type string (e.g. "<f8") of each column, with every string stored as a uint64
+/// length followed by the characters. It is followed by blocks of rows, each with the number
+/// of rows as uint64 and then the values of each column one after the other.
+/// Every thread fills its own buffer, which is written as a single block once full, so threads
+/// only synchronize once per block. Blocks of different threads are interleaved in the file,
+/// the event column keeps track of the neutrino each vertex belongs to
+class VertexWriter {
+    public:
+        static constexpr size_t default_block_size = 1 << 16;
+
+        ///@param filename: The file to write
+        ///@param nthreads: Number of threads writing to the file
+        ///@param block_size: Number of rows each thread buffers before writing a block
+        VertexWriter(const std::string &filename, size_t nthreads=1, size_t block_size=default_block_size);
+        VertexWriter(const VertexWriter&) = delete;
+        VertexWriter& operator=(const VertexWriter&) = delete;
+        /// Writes the remaining rows, errors are only logged. Call Close to get them as exceptions
+        ~VertexWriter();
+
+        /// Adds a vertex to the buffer of a thread
+        void Write(size_t thread, const Vector3D &position, MaterialId material, uint32_t Z, uint32_t A,
+                   double weight, uint64_t event) {
+            auto &buffer = Buffer(thread);
+            buffer.Add(position, material, Z, A, weight, event);
+            if(buffer.Size() >= m_block_size) WriteBlock(buffer);
+        }
+        /// Adds the vertices of a batch generated by DetectorSim::GenerateInteractions. Neutrinos
+        /// that did not cross any material (zero weight) are skipped
+        ///@param thread: Index of the calling thread
+        ///@param vertices: The vertices of the batch
+        ///@param first_event: Event number of the first neutrino of the batch, e.g. FluxBatch::first
+        void Write(size_t thread, const InteractionVertices &vertices, uint64_t first_event);
+
+        /// Writes the buffered rows of all threads and closes the file, once all threads are done
+        void Close();
+        /// Number of rows written to the file so far
+        size_t Rows() const { return m_rows.load(); }
+
+        /// Reads all the rows of a file written by a VertexWriter
+        static VertexColumns Read(const std::string &filename);
+
+    private:
+        VertexColumns& Buffer(size_t thread) {
+            if(thread >= m_buffers.size())
+                throw std::runtime_error("VertexWriter: Thread index " + std::to_string(thread)
+                                         + " out of range for " + std::to_string(m_buffers.size()) + " threads");
+            return m_buffers[thread].columns;
+        }
+        void WriteBlock(VertexColumns&);
+
+        static constexpr char magic[] = "NUGEOMVX";
+        static constexpr uint64_t version = 1;
+
+        std::string m_filename;
+        std::ofstream m_output;
+        std::mutex m_mutex;
+        // Keeps the buffers of different threads on separate cache lines
+        struct alignas(64) ThreadBuffer {
+            VertexColumns columns;
+        };
+        std::vector<ThreadBuffer> m_buffers;
+        size_t m_block_size;
+        std::atomic<size_t> m_rows{};
+};
+
+}
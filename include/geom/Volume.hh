@@ -1,92 +1,166 @@
 #pragma once
 
 #include "geom/Material.hh"
+#include "geom/MaterialTable.hh"
+#include "geom/Quaternion.hh"
 #include "geom/Shape.hh"
 
+#include <memory>
+
 namespace NuGeom {
 
 class LineSegment;
 class PhysicalVolume;
+struct SegmentRecord;
 
-class LogicalVolume {
+class LogicalVolume : public std::enable_shared_from_this<LogicalVolume> {
     public:
         LogicalVolume() = default;
         LogicalVolume(Material material, std::shared_ptr<Shape> shape)
-            : m_material{std::move(material)}, m_shape{std::move(shape)} {}
+            : m_material{MaterialTable::Global().Add(material)}, m_shape{std::move(shape)},
+              m_kernel{m_shape ? m_shape -> GetKernel() : ShapeKernel()}, m_kernel_single{m_kernel} {}
 
-        Material GetMaterial() const { return m_material; }
+        const Material& GetMaterial() const { return MaterialTable::Global().Get(m_material); }
+        MaterialId GetMaterialId() const { return m_material; }
+        /// Unique id of the volume, stored in the segment records
+        uint32_t GetId() const { return m_id; }
         Shape* GetShape() const { return m_shape.get(); }
+        const ShapeKernel& GetKernel() const { return m_kernel; }
+        const ShapeKernelF& GetKernelSingle() const { return m_kernel_single; }
         std::shared_ptr<LogicalVolume> Mother() const { return m_mother; }
         const std::vector<std::shared_ptr<PhysicalVolume>>& Daughters() const { return m_daughters; }
         void SetMother(std::shared_ptr<LogicalVolume> mother) { m_mother = mother; }
-        void AddDaughter(std::shared_ptr<PhysicalVolume> daughter) { m_daughters.push_back(daughter); }
+        /// Adds a placement of a volume inside this one. The placement keeps track of the volume it
+        /// was added to, so a logical volume shared by several mothers leaves into the right one
+        void AddDaughter(std::shared_ptr<PhysicalVolume> daughter);
         double Volume() const;
         double Mass() const;
 
         bool InWorld(const Vector3D&) const { return true; }
         bool SphereTrace(const Ray&, double&, size_t&, size_t&) const;
         bool RayTrace(const Ray&, double&, std::shared_ptr<PhysicalVolume>&) const;
+        /// Finds the closest daughter by intersecting all daughters in single precision
+        /// and only refining the candidates that can still be the closest hit in double precision
+        bool RayTraceSingle(const Ray&, double&, std::shared_ptr<PhysicalVolume>&) const;
+        /// Finds the closest daughter for each ray of the batch, looping over the rays for one
+        /// daughter at a time. Rays that miss all daughters get an infinite time and no volume
+        void RayTrace(const RayBatch&, std::vector<double>&, std::vector<std::shared_ptr<PhysicalVolume>>&) const;
         void GetLineSegments(const Ray&, std::vector<LineSegment>&) const;
+        /// Appends the segments along the ray to the buffer without clearing it. The distances
+        /// are offset by start, the distance along the original ray of the origin of the ray
+        void GetSegments(const Ray&, std::vector<SegmentRecord>&, double start=0) const;
+        /// Traces a batch of rays together. At each step the rays in the same volume are
+        /// intersected with its daughters and its shape as one batch
+        ///@param batch: The rays to trace
+        ///@param segments: Filled with the segments of all the rays, one ray after the other
+        ///@param offsets: Filled with batch.Size()+1 entries, the segments of ray i are in
+        ///                [offsets[i], offsets[i+1])
+        void GetSegments(const RayBatch&, std::vector<SegmentRecord>&, std::vector<size_t>&) const;
+        /// Adds the column density (density times path length) of each material along the ray
+        /// to the buffer, indexed by MaterialId. No segments are stored while tracing
+        void ColumnDensity(const Ray&, std::vector<double>&) const;
 
     private:
+        friend class PhysicalVolume;
+        template<typename Visitor>
+        void VisitSegments(const Ray&, Visitor&, double) const;
+        static uint32_t NextId();
         double DaughterVolumes() const;
         double DaughterMass() const;
         std::pair<double, size_t> GetSDF(const Vector3D&) const { return {0, 0}; }
 
-        Material m_material;
+        MaterialId m_material{};
+        uint32_t m_id{NextId()};
         std::shared_ptr<Shape> m_shape;
+        ShapeKernel m_kernel;
+        ShapeKernelF m_kernel_single;
         std::vector<std::shared_ptr<PhysicalVolume>> m_daughters;
         std::shared_ptr<LogicalVolume> m_mother = nullptr;
         static constexpr size_t m_max_steps{512};
         static constexpr double m_epsilon{1e-4};
+        static constexpr float m_single_tolerance{1e-4f};
 };
 
 class PhysicalVolume {
     public:
         PhysicalVolume() = default;
         PhysicalVolume(std::shared_ptr<LogicalVolume> volume, Transform3D trans, Transform3D rot)
-            : m_volume{std::move(volume)} {
-
-            m_transform = (rot*trans).Inverse();
-            m_transform.Decompose(m_scale, m_rot, m_trans);
-            is_identity = m_transform.IsIdentity();
-            is_translation = m_rot.IsIdentity() && !m_trans.IsIdentity();
-        }
+            : m_volume{std::move(volume)}, m_transform{(trans*rot).Inverse()},
+              m_rigid{RigidTransform3D::IsRigid(m_transform.Forward())},
+              m_placement{m_rigid ? RigidTransform3D(m_transform.Forward()) : RigidTransform3D()} {}
 
         const std::shared_ptr<LogicalVolume>& GetLogicalVolume() const { return m_volume; }
-        Transform3D GetTransform() const { return m_transform; }
+        /// Transform from the frame of the mother volume into the local frame of this volume
+        const Transform3D& GetTransform() const { return m_transform.Forward(); }
         std::shared_ptr<LogicalVolume> LogicalMother() const { 
-            return m_mother ? m_mother -> GetLogicalVolume() : m_volume -> Mother();
+            if(m_mother) return m_mother -> GetLogicalVolume();
+            if(auto placed_in = m_placed_in.lock()) return placed_in;
+            return m_volume -> Mother();
         }
         std::shared_ptr<PhysicalVolume> Mother() const { return m_mother; }
         void SetMother(std::shared_ptr<PhysicalVolume> mother) { m_mother = std::move(mother); }
         const std::vector<std::shared_ptr<PhysicalVolume>>& Daughters() const { return m_volume -> Daughters(); }
         double SignedDistance(const Vector3D &in_point) const {
             auto point = TransformPoint(in_point);
-            return m_volume -> GetShape() -> SignedDistance(point);
+            return m_volume -> GetKernel().SignedDistance(point);
         }
         double Intersect(const Ray &in_ray) const;
+        float IntersectSingle(const Ray &in_ray) const;
+        void Intersect(const RayBatch&, std::vector<double>&) const;
         bool RayTrace(const Ray &ray, double &time, std::shared_ptr<PhysicalVolume> &pvol) const {
             return m_volume -> RayTrace(ray, time, pvol);
         }
-        void GetLineSegments(const Ray&, std::vector<LineSegment>&, const Transform3D&) const;
+        void GetLineSegments(const Ray&, std::vector<LineSegment>&, const RigidTransform3D&) const;
+        void GetSegments(const Ray&, std::vector<SegmentRecord>&, const RigidTransform3D&, double) const;
 
     private:
+        friend class LogicalVolume;
+        // Transform from the global frame into the frame a volume is placed in. Composed as a
+        // quaternion while all the placements are rigid, and as a matrix after a reflected or
+        // scaled placement
+        struct Chain {
+            RigidTransform3D rigid{};
+            Transform3D matrix{};
+            bool is_rigid{true};
+
+            Transform3D Matrix() const { return is_rigid ? rigid.ToTransform() : matrix; }
+            /// Times along the returned ray are divided by length to get global times
+            Ray Apply(const Ray &ray, double &length) const {
+                if(!is_rigid) return matrix.Apply(ray, length);
+                length = 1;
+                return rigid.Apply(ray);
+            }
+        };
+        /// Chain into the frame of this volume, from the chain into the frame it is placed in
+        Chain Enter(const Chain &chain) const {
+            if(chain.is_rigid && m_rigid) return {m_placement*chain.rigid};
+            return {{}, m_transform.Forward()*chain.Matrix(), false};
+        }
+        /// Chain out of the frame of this volume, the inverse of Enter
+        Chain Leave(const Chain &chain) const {
+            if(chain.is_rigid && m_rigid) return {m_placement.Inverse()*chain.rigid};
+            return {{}, m_transform.Inverse()*chain.Matrix(), false};
+        }
+        template<typename Visitor>
+        void VisitSegments(const Ray&, Visitor&, const Chain&, double) const;
         Vector3D TransformPoint(const Vector3D &point) const {
             return m_transform.Apply(point);
         }
         Vector3D TransformPointInverse(const Vector3D &point) const {
-            return m_transform.Inverse().Apply(point);
+            return m_transform.ApplyInverse(point);
         }
-        Ray TransformRay(const Ray &ray) const;
-        Ray TransformRayInverse(const Ray &ray) const;
+        /// Ray in the local frame, times along it are divided by length to get times in the mother
+        Ray TransformRay(const Ray &ray, double &length) const { return m_transform.Apply(ray, length); }
+        Ray TransformRayInverse(const Ray &ray) const { return m_transform.ApplyInverse(ray); }
         std::shared_ptr<LogicalVolume> m_volume;
         std::shared_ptr<PhysicalVolume> m_mother;
-        Transform3D m_transform;
-        Scale3D m_scale;
-        Rotation3D m_rot;
-        Translation3D m_trans;
-        bool is_identity, is_translation;
+        // Logical volume this placement was added to, not owning since the mother owns its daughters
+        std::weak_ptr<LogicalVolume> m_placed_in;
+        CachedTransform3D m_transform;
+        // Same transform as a quaternion, used to compose the chain of placements in GetLineSegments.
+        // Only set for rigid transforms, reflections and scales go through m_transform
+        bool m_rigid{true};
+        RigidTransform3D m_placement;
 };
 
 }
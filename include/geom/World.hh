@@ -1,14 +1,16 @@
 #pragma once
 
 #include "geom/Material.hh"
+#include "geom/Ray.hh"
+#include "geom/RayBatch.hh"
 #include "geom/Shape.hh"
 #include "geom/Volume.hh"
 #include <vector>
 
 namespace NuGeom {
 
-class Ray;
 class LineSegment;
+struct SegmentRecord;
 
 class World {
     public:
@@ -25,8 +27,33 @@ class World {
         bool InWorld(const Vector3D&) const;
         bool SphereTrace(const Ray&, double&, size_t&, size_t&) const;
         bool RayTrace(const Ray&, double&, size_t&) const;
+        /// Traces a batch of rays to the closest daughter of the world volume
+        ///@param batch: The rays to trace
+        ///@param distances: Filled with the distance to the closest daughter (infinity for a miss)
+        ///@param idxs: Filled with the index of the closest daughter (0 for a miss)
+        void RayTrace(const RayBatch&, std::vector<double>&, std::vector<size_t>&) const;
         std::vector<LineSegment> GetLineSegments(const Ray&) const;
+        std::vector<std::vector<LineSegment>> GetLineSegments(const RayBatch&) const;
+        /// Appends the segments along the ray to a buffer owned by the caller. The buffer is not
+        /// cleared, so it can be reused across rays without reallocating
+        void GetLineSegments(const Ray&, std::vector<SegmentRecord>&) const;
+        /// Traces a batch of rays into a single buffer
+        ///@param batch: The rays to trace
+        ///@param segments: Filled with the segments of all the rays, one ray after the other
+        ///@param offsets: Filled with batch.Size()+1 entries, the segments of ray i are in
+        ///                [offsets[i], offsets[i+1])
+        void GetLineSegments(const RayBatch&, std::vector<SegmentRecord>&, std::vector<size_t>&) const;
+        /// Column density (density times path length) of each material along the ray, accumulated
+        /// during the traversal without storing any segments. The buffers are reused across calls
+        ///@param ray: The ray to trace
+        ///@param per_material: Filled with the column density of each material, indexed by MaterialId
+        ///@param per_element: If given, filled with the areal density of each element from the mass
+        ///                    fractions of the materials, indexed by ElementId
+        void ColumnDensity(const Ray&, std::vector<double>&, std::vector<double>* = nullptr) const;
         size_t NDaughters() const { return m_volume -> Daughters().size(); }
+        /// Hash of the materials, shapes and placements of the geometry, used to key on disk caches
+        /// of quantities derived from it. Shapes enter through Shape::Hash
+        uint64_t Fingerprint() const;
 
     private:
         std::pair<double, size_t> GetSDF(const Vector3D&) const;
@@ -0,0 +1,61 @@
+#include "geom/AliasTable.hh"
+
+#include <numeric>
+#include <stdexcept>
+
+using NuGeom::AliasTable;
+
+bool AliasTable::Update(const std::vector<double> &weights) {
+    if(weights == m_weights) return false;
+    Build(weights);
+    return true;
+}
+
+void AliasTable::Build(const std::vector<double> &weights) {
+    if(weights.empty())
+        throw std::runtime_error("AliasTable: No weights given");
+    double sum = 0;
+    for(const auto &weight : weights) {
+        if(!(weight >= 0))
+            throw std::runtime_error("AliasTable: Weights must be non-negative");
+        sum += weight;
+    }
+    if(!(sum > 0))
+        throw std::runtime_error("AliasTable: Weights sum to zero");
+
+    const size_t n = weights.size();
+    m_weights = weights;
+    m_sum = sum;
+    m_prob.assign(n, 0);
+    m_alias.resize(n);
+    std::iota(m_alias.begin(), m_alias.end(), 0);
+
+    // Split the scaled weights into the ones below and above the average
+    std::vector<double> scaled(n);
+    std::vector<size_t> small, large;
+    small.reserve(n);
+    large.reserve(n);
+    for(size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i]*static_cast<double>(n)/sum;
+        if(scaled[i] < 1) small.push_back(i);
+        else large.push_back(i);
+    }
+
+    // Fill each small bin up to one with the excess of a large bin
+    while(!small.empty() && !large.empty()) {
+        const size_t less = small.back();
+        const size_t more = large.back();
+        small.pop_back();
+        m_prob[less] = scaled[less];
+        m_alias[less] = more;
+        scaled[more] -= 1 - scaled[less];
+        if(scaled[more] < 1) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+
+    // What is left is one up to rounding
+    for(const auto &i : large) m_prob[i] = 1;
+    for(const auto &i : small) m_prob[i] = 1;
+}
@@ -0,0 +1,59 @@
+#include "geom/CrossSectionCache.hh"
+
+#include <cmath>
+#include <stdexcept>
+
+using NuGeom::CrossSectionCache;
+
+CrossSectionCache::CrossSectionCache(Calculator calculator, double tolerance, size_t capacity)
+    : m_calculator{std::move(calculator)}, m_log_width{std::log1p(tolerance)},
+      m_shard_capacity{(capacity + nshards - 1)/nshards} {
+    if(!m_calculator)
+        throw std::runtime_error("CrossSectionCache: No calculator given");
+    if(!(tolerance > 0))
+        throw std::runtime_error("CrossSectionCache: Tolerance must be positive");
+    if(capacity == 0)
+        throw std::runtime_error("CrossSectionCache: Capacity must be positive");
+}
+
+double CrossSectionCache::operator()(const Element &elm, double energy) {
+    if(!(energy > 0)) return m_calculator(elm, energy);
+
+    const auto bin = static_cast<int64_t>(std::floor(std::log(energy)/m_log_width));
+    const Key key{elm.Z(), elm.A(), bin};
+    auto &shard = m_shards[KeyHash{}(key) % nshards];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.values.find(key);
+        if(it != shard.values.end()) {
+            ++m_hits;
+            return it -> second;
+        }
+    }
+
+    // Evaluate outside the lock, other threads may compute the same bin at the same time
+    ++m_misses;
+    const double value = m_calculator(elm, std::exp((static_cast<double>(bin) + 0.5)*m_log_width));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if(shard.values.size() >= m_shard_capacity) shard.values.clear();
+    shard.values.emplace(key, value);
+    return value;
+}
+
+size_t CrossSectionCache::Size() const {
+    size_t size = 0;
+    for(const auto &shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size += shard.values.size();
+    }
+    return size;
+}
+
+void CrossSectionCache::Clear() {
+    for(auto &shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.values.clear();
+    }
+    m_hits = 0;
+    m_misses = 0;
+}
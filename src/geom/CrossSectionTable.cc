@@ -0,0 +1,124 @@
+#include "geom/CrossSectionTable.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using NuGeom::CrossSectionTable;
+
+CrossSectionTable::CrossSectionTable(const Calculator &calculator, std::vector<double> energies,
+                                     const MaterialTable &materials)
+    : m_energies{std::move(energies)} {
+    if(m_energies.size() < 2)
+        throw std::runtime_error("CrossSectionTable: Energy grid needs at least two points");
+    for(size_t i = 0; i < m_energies.size(); ++i) {
+        if(!(m_energies[i] > 0) || (i > 0 && !(m_energies[i] > m_energies[i-1])))
+            throw std::runtime_error("CrossSectionTable: Energy grid must be positive and increasing");
+        m_log_energies.push_back(std::log(m_energies[i]));
+    }
+    Extend(calculator, materials);
+}
+
+void CrossSectionTable::Extend(const Calculator &calculator, const MaterialTable &materials) {
+    const auto first = static_cast<MaterialId>(m_materials.size());
+    if(materials.Size() <= first) return;
+    m_materials.resize(materials.Size());
+    for(MaterialId id = first; id < materials.Size(); ++id) {
+        const auto &material = materials.Get(id);
+        const auto &elements = material.Elements();
+        const auto &fractions = material.MassFractions();
+        auto &entry = m_materials[id];
+        entry.nelements = std::min(elements.size(), fractions.size());
+        entry.values.reserve(m_energies.size()*(entry.nelements + 1));
+
+        std::vector<double> contributions(entry.nelements);
+        for(const auto &energy : m_energies) {
+            double total = 0;
+            for(size_t i = 0; i < entry.nelements; ++i) {
+                contributions[i] = fractions[i]*calculator(elements[i], energy);
+                total += contributions[i];
+            }
+            entry.values.push_back(total);
+            entry.values.insert(entry.values.end(), contributions.begin(), contributions.end());
+            if(total > 0) entry.samplers.emplace_back(contributions);
+            else entry.samplers.emplace_back();
+        }
+    }
+}
+
+std::vector<double> CrossSectionTable::LogSpaced(double min, double max, size_t n) {
+    if(!(min > 0) || !(max > min) || n < 2)
+        throw std::runtime_error("CrossSectionTable: Invalid log spaced grid");
+    std::vector<double> grid(n);
+    const double step = std::log(max/min)/static_cast<double>(n - 1);
+    for(size_t i = 0; i < n; ++i) grid[i] = min*std::exp(step*static_cast<double>(i));
+    grid.back() = max;
+    return grid;
+}
+
+double CrossSectionTable::Total(MaterialId id, double energy) const {
+    const auto &entry = Get(id);
+    const auto [bin, frac] = Locate(energy);
+    const size_t stride = entry.nelements + 1;
+    return Interpolate(entry.values[bin*stride], entry.values[(bin + 1)*stride], frac);
+}
+
+void CrossSectionTable::Contributions(MaterialId id, double energy, std::vector<double> &contributions) const {
+    const auto &entry = Get(id);
+    const auto [bin, frac] = Locate(energy);
+    const size_t stride = entry.nelements + 1;
+    contributions.resize(entry.nelements);
+    for(size_t i = 0; i < entry.nelements; ++i) {
+        contributions[i] = Interpolate(entry.values[bin*stride + i + 1],
+                                       entry.values[(bin + 1)*stride + i + 1], frac);
+    }
+}
+
+const NuGeom::AliasTable& CrossSectionTable::ElementSampler(MaterialId id, double energy) const {
+    const auto &entry = Get(id);
+    const auto bin = Locate(energy).first;
+    if(entry.samplers[bin].Empty())
+        throw std::runtime_error("CrossSectionTable: Material " + std::to_string(id)
+                                 + " has no cross section at this energy");
+    return entry.samplers[bin];
+}
+
+size_t CrossSectionTable::SampleElement(MaterialId id, double energy, double ran) const {
+    const auto &entry = Get(id);
+    const auto [bin, frac] = Locate(energy);
+    const size_t stride = entry.nelements + 1;
+    const double low = (1 - frac)*entry.values[bin*stride];
+    const double high = frac*entry.values[(bin + 1)*stride];
+    if(!(low + high > 0))
+        throw std::runtime_error("CrossSectionTable: Material " + std::to_string(id)
+                                 + " has no cross section at this energy");
+    // Reuse the random number for the sampler of the chosen grid point
+    const double split = low/(low + high);
+    if(ran < split) return entry.samplers[bin].Sample(ran/split);
+    return entry.samplers[bin + 1].Sample((ran - split)/(1 - split));
+}
+
+const CrossSectionTable::Entry& CrossSectionTable::Get(MaterialId id) const {
+    if(id >= m_materials.size())
+        throw std::runtime_error("CrossSectionTable: Material id " + std::to_string(id) + " is not tabulated,"
+                                 " call Extend after adding materials");
+    return m_materials[id];
+}
+
+std::pair<size_t, double> CrossSectionTable::Locate(double energy) const {
+    if(m_energies.empty())
+        throw std::runtime_error("CrossSectionTable: Table is empty");
+    if(!(energy > m_energies.front())) return {0, 0};
+    if(!(energy < m_energies.back())) return {m_energies.size() - 2, 1};
+
+    auto it = std::upper_bound(m_energies.begin(), m_energies.end(), energy);
+    auto bin = static_cast<size_t>(std::distance(m_energies.begin(), it)) - 1;
+    double frac = (std::log(energy) - m_log_energies[bin])/(m_log_energies[bin+1] - m_log_energies[bin]);
+    return {bin, frac};
+}
+
+double CrossSectionTable::Interpolate(double low, double high, double frac) {
+    if(low > 0 && high > 0) return low*std::pow(high/low, frac);
+    return low + (high - low)*frac;
+}
@@ -0,0 +1,144 @@
+#include "geom/DensityMap.hh"
+#include "geom/Parallel.hh"
+
+#include "fmt/format.h"
+#include "lodepng/lodepng.h"
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+void WriteUInt64(std::ostream &output, uint64_t value) {
+    char bytes[8];
+    for(size_t i = 0; i < 8; ++i) bytes[i] = static_cast<char>(value >> (8*i));
+    output.write(bytes, 8);
+}
+
+uint64_t ReadUInt64(std::istream &input) {
+    unsigned char bytes[8];
+    input.read(reinterpret_cast<char*>(bytes), 8);
+    if(!input) throw std::runtime_error("DensityMap: Unexpected end of file");
+    uint64_t value = 0;
+    for(size_t i = 0; i < 8; ++i) value |= uint64_t{bytes[i]} << (8*i);
+    return value;
+}
+
+void WriteDoubles(std::ostream &output, const std::vector<double> &values) {
+    static_assert(sizeof(double) == sizeof(uint64_t));
+    for(const auto &value : values) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        WriteUInt64(output, bits);
+    }
+}
+
+void ReadDoubles(std::istream &input, std::vector<double> &values) {
+    for(auto &value : values) {
+        const uint64_t bits = ReadUInt64(input);
+        std::memcpy(&value, &bits, sizeof(bits));
+    }
+}
+
+}
+
+NuGeom::DensityMap::DensityMap(size_t nu, size_t nv, std::vector<std::string> names)
+    : m_nu{nu}, m_nv{nv}, m_names{std::move(names)},
+      m_total(nu*nv, 0), m_density(nu*nv*m_names.size(), 0) {}
+
+NuGeom::DensityMap NuGeom::DensityMap::Trace(const World &world, const FluxWindow &window,
+                                             size_t nu, size_t nv, size_t nthreads) {
+    if(nu == 0 || nv == 0) throw std::runtime_error("DensityMap: The grid needs at least one pixel");
+
+    const auto &table = MaterialTable::Global();
+    std::vector<std::string> names;
+    names.reserve(table.Size());
+    for(MaterialId id = 0; id < table.Size(); ++id) names.push_back(table.Get(id).Name());
+    DensityMap map(nu, nv, std::move(names));
+
+    const size_t npixels = map.NPixels(), nmaterials = map.NMaterials();
+    std::vector<std::vector<double>> columns(ThreadCount(nthreads));
+    ParallelFor(npixels, 256, columns.size(), [&](size_t thread, size_t begin, size_t end) {
+        auto &column = columns[thread];
+        for(size_t pixel = begin; pixel < end; ++pixel) {
+            const double u = (static_cast<double>(pixel % nu) + 0.5)/static_cast<double>(nu);
+            const double v = (static_cast<double>(pixel / nu) + 0.5)/static_cast<double>(nv);
+            world.ColumnDensity(window.GetRay(u, v), column);
+            double total = 0;
+            for(size_t id = 0; id < std::min(column.size(), nmaterials); ++id) {
+                map.m_density[id*npixels + pixel] = column[id];
+                total += column[id];
+            }
+            map.m_total[pixel] = total;
+        }
+    });
+    return map;
+}
+
+void NuGeom::DensityMap::Write(const std::string &filename) const {
+    std::ofstream output(filename, std::ios::binary);
+    if(!output) throw std::runtime_error("DensityMap: Could not open " + filename);
+    output.write(magic, sizeof(magic) - 1);
+    WriteUInt64(output, version);
+    WriteUInt64(output, m_nu);
+    WriteUInt64(output, m_nv);
+    WriteUInt64(output, m_names.size());
+    for(const auto &name : m_names) {
+        WriteUInt64(output, name.size());
+        output.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    WriteDoubles(output, m_total);
+    WriteDoubles(output, m_density);
+    if(!output) throw std::runtime_error("DensityMap: Could not write " + filename);
+}
+
+NuGeom::DensityMap NuGeom::DensityMap::Read(const std::string &filename) {
+    std::ifstream input(filename, std::ios::binary);
+    if(!input) throw std::runtime_error("DensityMap: Could not open " + filename);
+    char header[sizeof(magic) - 1];
+    input.read(header, sizeof(header));
+    if(!input || std::memcmp(header, magic, sizeof(header)) != 0)
+        throw std::runtime_error("DensityMap: " + filename + " is not a density map");
+    if(const auto file_version = ReadUInt64(input); file_version != version)
+        throw std::runtime_error("DensityMap: Unsupported version " + std::to_string(file_version));
+
+    const size_t nu = ReadUInt64(input);
+    const size_t nv = ReadUInt64(input);
+    std::vector<std::string> names(ReadUInt64(input));
+    for(auto &name : names) {
+        name.resize(ReadUInt64(input));
+        input.read(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    DensityMap map(nu, nv, std::move(names));
+    ReadDoubles(input, map.m_total);
+    ReadDoubles(input, map.m_density);
+    return map;
+}
+
+void NuGeom::DensityMap::WritePNG(const std::string &filename, std::optional<MaterialId> id) const {
+    if(NPixels() == 0) throw std::runtime_error("DensityMap: Can not write an empty map");
+    if(id && *id >= NMaterials())
+        throw std::runtime_error("DensityMap: Undefined material id " + std::to_string(*id));
+    const double *values = id ? m_density.data() + *id*NPixels() : m_total.data();
+    const double maximum = *std::max_element(values, values + NPixels());
+    const double scale = maximum > 0 ? 65535/maximum : 0;
+
+    // 16 bit samples are stored big endian, with the first row at the top of the image
+    std::vector<unsigned char> image(2*NPixels());
+    for(size_t iv = 0; iv < m_nv; ++iv) {
+        for(size_t iu = 0; iu < m_nu; ++iu) {
+            const auto sample = static_cast<unsigned>(values[Pixel(iu, iv)]*scale + 0.5);
+            const size_t index = 2*((m_nv - 1 - iv)*m_nu + iu);
+            image[index] = static_cast<unsigned char>(sample >> 8);
+            image[index + 1] = static_cast<unsigned char>(sample);
+        }
+    }
+    const unsigned error = lodepng::encode(filename, image, static_cast<unsigned>(m_nu),
+                                           static_cast<unsigned>(m_nv), LCT_GREY, 16);
+    if(error) throw std::runtime_error(fmt::format("DensityMap: Could not write {}: {}", filename,
+                                                   lodepng_error_text(error)));
+    spdlog::debug("DensityMap: Wrote {} with a maximum of {}", filename, maximum);
+}
@@ -2,24 +2,37 @@
 #include "geom/Units.hh"
 // #include "yaml-cpp/yaml.h"
 
+#include <cmath>
 #include <stdexcept>
 
 using NuGeom::Element;
+using NuGeom::IsotopeRegistry;
 
 Element::Element(const std::string &name) {
-    if(CommonElements().find(name) == CommonElements().end()) {
+    auto it = CommonElements().find(name);
+    if(it != CommonElements().end()) {
+        *this = it -> second;
+        return;
+    }
+
+    auto Z = PeriodicTable::Find(name);
+    if(Z == 0) {
         throw std::runtime_error("Invalid element " + name);
     }
-    *this = CommonElements().at(name);
+    *this = Element(Z);
+}
+
+Element::Element(ElementId Z) : m_Z{Z}, m_id{Z} {
+    const auto &data = PeriodicTable::Get(Z);
+    m_name = std::string(data.name);
+    m_symbol = std::string(data.symbol);
+    m_mass = data.mass;
+    m_A = static_cast<size_t>(std::lround(data.mass));
 }
 
 Element::Element(const std::string &name, size_t Z,
                  double mass, size_t A) : m_name{name}, m_Z{Z}, m_mass{mass} {
-    if(A == 0) {
-        m_A = static_cast<size_t>(mass);
-    } else {
-        m_A = A;
-    }
+    AssignId(A);
 
     if(CommonElements().find(name) == CommonElements().end()) {
         CommonElements()[name] = *this;
@@ -28,11 +41,7 @@ Element::Element(const std::string &name, size_t Z,
 
 Element::Element(const std::string &name, const std::string &symbol,
                  size_t Z, double mass, size_t A) : m_name{name}, m_symbol{symbol}, m_Z{Z}, m_mass{mass} {
-    if(A == 0) {
-        m_A = static_cast<size_t>(mass);
-    } else {
-        m_A = A;
-    }
+    AssignId(A);
 
     if(CommonElements().find(name) == CommonElements().end()) {
         CommonElements()[name] = *this;        
@@ -43,6 +52,42 @@ Element::Element(const std::string &name, const std::string &symbol,
     }
 }
 
+void Element::AssignId(size_t A) {
+    const auto Z = static_cast<ElementId>(m_Z);
+    if(A == 0 && PeriodicTable::IsNatural(Z)
+       && std::abs(m_mass - PeriodicTable::Get(Z).mass) <= natural_mass_tolerance*PeriodicTable::Get(Z).mass) {
+        m_A = static_cast<size_t>(std::lround(m_mass));
+        m_id = Z;
+        return;
+    }
+    // Equality compares ids, so any other mass needs an id of its own
+    m_A = A != 0 ? A : static_cast<size_t>(std::lround(m_mass));
+    m_id = IsotopeRegistry::Global().Add(m_Z, m_A, m_mass);
+}
+
+IsotopeRegistry& IsotopeRegistry::Global() {
+    static IsotopeRegistry registry;
+    return registry;
+}
+
+NuGeom::ElementId IsotopeRegistry::Add(size_t Z, size_t A, double mass) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find({Z, A, mass});
+    if(it != m_ids.end()) return it -> second;
+
+    auto id = static_cast<ElementId>(FirstId + m_isotopes.size());
+    m_isotopes.push_back({Z, A, mass});
+    m_ids[{Z, A, mass}] = id;
+    return id;
+}
+
+const IsotopeRegistry::Isotope& IsotopeRegistry::Get(ElementId id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(id < FirstId || id - FirstId >= m_isotopes.size())
+        throw std::runtime_error("IsotopeRegistry: Undefined isotope id " + std::to_string(id));
+    return m_isotopes[id - FirstId];
+}
+
 // void NuGeom::LoadElements(const YAML::Node &node) {
 //     for(const auto &subnode : node) {
 //         auto name = subnode[0].as<std::string>();
@@ -0,0 +1,85 @@
+#include "geom/Flux.hh"
+
+#include "spdlog/spdlog.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NuGeom::MappedFluxFile::MappedFluxFile(const std::string &filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) throw std::runtime_error("MappedFluxFile: Could not open " + filename + ": " + std::strerror(errno));
+    struct stat info{};
+    if(fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("MappedFluxFile: Could not read the size of " + filename);
+    }
+    m_mapping_size = static_cast<size_t>(info.st_size);
+    if(m_mapping_size < header_size) {
+        close(fd);
+        throw std::runtime_error("MappedFluxFile: " + filename + " is not a flux file");
+    }
+    m_mapping = mmap(nullptr, m_mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if(m_mapping == MAP_FAILED) {
+        m_mapping = nullptr;
+        throw std::runtime_error("MappedFluxFile: Could not map " + filename + ": " + std::strerror(errno));
+    }
+    madvise(m_mapping, m_mapping_size, MADV_SEQUENTIAL);
+
+    const auto *data = static_cast<const char*>(m_mapping);
+    uint64_t header[3];
+    std::memcpy(header, data, header_size);
+    std::string error;
+    if(std::memcmp(data, magic, sizeof(uint64_t)) != 0)
+        error = filename + " is not a flux file";
+    else if(header[1] != version)
+        error = "Unsupported version " + std::to_string(header[1]);
+    else if(header[2] != sizeof(FluxRecord))
+        error = "Records of " + filename + " do not match the size of FluxRecord, was it written on a machine with another byte order?";
+    else if((m_mapping_size - header_size) % sizeof(FluxRecord) != 0)
+        error = filename + " ends in a partial record";
+    if(!error.empty()) {
+        munmap(m_mapping, m_mapping_size);
+        m_mapping = nullptr;
+        throw std::runtime_error("MappedFluxFile: " + error);
+    }
+
+    // The mapping is page aligned and the header is a multiple of 8 bytes, so the records are aligned
+    m_records = reinterpret_cast<const FluxRecord*>(data + header_size);
+    m_size = (m_mapping_size - header_size)/sizeof(FluxRecord);
+    spdlog::debug("MappedFluxFile: Mapped {} records from {}", m_size, filename);
+}
+
+NuGeom::MappedFluxFile::~MappedFluxFile() {
+    if(m_mapping) munmap(m_mapping, m_mapping_size);
+}
+
+NuGeom::FluxStream NuGeom::MappedFluxFile::Shard(size_t index, size_t nshards) const {
+    if(index >= nshards)
+        throw std::runtime_error("MappedFluxFile: Shard " + std::to_string(index) + " out of "
+                                 + std::to_string(nshards));
+    // Shards differ in size by at most one record
+    const size_t per_shard = m_size/nshards, remainder = m_size%nshards;
+    const size_t begin = index*per_shard + std::min(index, remainder);
+    const size_t end = begin + per_shard + (index < remainder ? 1 : 0);
+    return {m_records, begin, end};
+}
+
+void NuGeom::MappedFluxFile::Write(const std::string &filename, const std::vector<FluxRecord> &records) {
+    std::ofstream output(filename, std::ios::binary);
+    if(!output) throw std::runtime_error("MappedFluxFile: Could not open " + filename);
+    const uint64_t header[] = {version, sizeof(FluxRecord)};
+    output.write(magic, sizeof(uint64_t));
+    output.write(reinterpret_cast<const char*>(header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(records.data()),
+                 static_cast<std::streamsize>(records.size()*sizeof(FluxRecord)));
+    if(!output) throw std::runtime_error("MappedFluxFile: Could not write " + filename);
+}
@@ -0,0 +1,51 @@
+#include "geom/FluxSampler.hh"
+
+#include "spdlog/spdlog.h"
+
+#include <stdexcept>
+
+NuGeom::FluxSampler::FluxSampler(const World &world, const FluxWindow &window, const FluxSamplerOptions &options)
+    : FluxSampler(window, DensityMap::Trace(world, window, options.nu, options.nv, options.nthreads), options) {}
+
+NuGeom::FluxSampler::FluxSampler(const FluxWindow &window, DensityMap map, const FluxSamplerOptions &options)
+    : m_window{window}, m_map{std::move(map)} {
+    if(!(options.uniform_fraction >= 0 && options.uniform_fraction <= 1))
+        throw std::runtime_error("FluxSampler: The uniform fraction has to be in [0, 1]");
+    const auto &material_weights = options.material_weights;
+    if(!material_weights.empty() && material_weights.size() != m_map.NMaterials())
+        throw std::runtime_error("FluxSampler: Expected a weight for each of the "
+                                 + std::to_string(m_map.NMaterials()) + " materials");
+    const size_t npixels = m_map.NPixels();
+    if(npixels == 0) throw std::runtime_error("FluxSampler: The density map is empty");
+
+    std::vector<double> importance(npixels, 0);
+    if(material_weights.empty()) {
+        importance = m_map.Totals();
+    } else {
+        const auto &densities = m_map.Densities();
+        for(size_t id = 0; id < material_weights.size(); ++id) {
+            if(material_weights[id] == 0) continue;
+            for(size_t pixel = 0; pixel < npixels; ++pixel)
+                importance[pixel] += material_weights[id]*densities[id*npixels + pixel];
+        }
+    }
+
+    double sum = 0;
+    for(const auto &value : importance) sum += value;
+    double uniform_fraction = options.uniform_fraction;
+    if(!(sum > 0)) {
+        spdlog::warn("FluxSampler: No material of interest seen by the map, sampling uniformly");
+        uniform_fraction = 1;
+        sum = 1;
+    }
+
+    // Mixture of the importance map and a uniform distribution, the weight is the ratio of
+    // the uniform probability to the probability of the pixel
+    const double uniform = 1/static_cast<double>(npixels);
+    m_weights.resize(npixels);
+    for(size_t pixel = 0; pixel < npixels; ++pixel) {
+        importance[pixel] = (1 - uniform_fraction)*importance[pixel]/sum + uniform_fraction*uniform;
+        m_weights[pixel] = importance[pixel] > 0 ? uniform/importance[pixel] : 0;
+    }
+    m_pixels = AliasTable(importance);
+}
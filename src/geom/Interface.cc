@@ -1,5 +1,7 @@
 #include "geom/Interface.hh"
 
+#include <memory>
+
 class CrossSectionTest {
     public:
         double Evaluate(size_t Z, size_t A, double) const {
@@ -7,34 +9,55 @@ class CrossSectionTest {
         }
 };
 
-class FluxTest {
+/// Pencil beam along the z-axis, used if no flux file is given
+class BeamFlux : public NuGeom::FluxDriver {
     public:
-        std::pair<NuGeom::Vector3D, NuGeom::Vector3D> GetFlux(const std::vector<double>&) { return {{0, 0, -200}, {0, 0, 1}}; }
+        explicit BeamFlux(size_t nevents)
+            : m_records(nevents, {{0, 0, -200}, {0, 0, 1}, 1300, 1, 0, 0, 0}),
+              m_stream(m_records.data(), 0, nevents) {}
+        NuGeom::FluxBatch Next(size_t max_size) override { return m_stream.Next(max_size); }
+
+    private:
+        std::vector<NuGeom::FluxRecord> m_records;
+        NuGeom::FluxStream m_stream;
 };
 
 int main(int argc, char *argv[]) {
-    if(argc != 2) {
-        std::cout << "Usage:\n  prob_test <input>\n";
+    if(argc != 2 && argc != 3) {
+        std::cout << "Usage:\n  prob_test <input> [flux file]\n";
         return -1;
     }
     // Setup detector
     NuGeom::DetectorSim sim(argv[1]);
     CrossSectionTest test;
-    FluxTest flux;
     auto func = [&](const NuGeom::Element &elm, double nu_energy) {
         return test.Evaluate(elm.Z(), elm.A(), nu_energy);
     };
     sim.SetCrossSectionCalculator(func);
 
-    // Generate rays and get interaction points
-    size_t nevents = 5;
-    for(size_t i = 0; i < nevents; ++i) {
-        // Get random numbers
-        auto neutrino = flux.GetFlux({});
-        NuGeom::Vector3D start = neutrino.first;
-        NuGeom::Vector3D direction = neutrino.second;
-        auto result = sim.GetInteraction(start, direction, 1300);
-        std::cout << result.first << " " << result.second.Name() << std::endl;
+    // Setup flux, the file has to stay open while its records are used
+    std::unique_ptr<NuGeom::MappedFluxFile> file;
+    std::unique_ptr<NuGeom::FluxDriver> flux;
+    if(argc == 3) {
+        file = std::make_unique<NuGeom::MappedFluxFile>(argv[2]);
+        flux = std::make_unique<NuGeom::FluxStream>(file -> Stream());
+    } else {
+        flux = std::make_unique<BeamFlux>(5);
+    }
+
+    // Get interaction points for each batch of neutrinos
+    constexpr size_t batch_size = 4096;
+    constexpr uint64_t seed = 12345;
+    NuGeom::InteractionVertices vertices;
+    for(auto batch = flux -> Next(batch_size); !batch.Empty(); batch = flux -> Next(batch_size)) {
+        sim.GenerateInteractions(batch, seed, vertices);
+        for(size_t i = 0; i < vertices.Size(); ++i) {
+            if(vertices.weights[i] == 0) continue;
+            const auto &material = NuGeom::MaterialTable::Global().Get(vertices.materials[i]);
+            const auto target = std::find_if(material.Elements().begin(), material.Elements().end(),
+                                             [&](const auto &elm) { return elm.Id() == vertices.elements[i]; });
+            std::cout << vertices.positions[i] << " " << target -> Name() << " " << vertices.weights[i] << std::endl;
+        }
         // CrossSection Tool would simulate the actual interaction
     }
 }
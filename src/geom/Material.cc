@@ -32,6 +32,7 @@ void Material::AddElement(const Element &elm, int natoms) {
         for(size_t i = 0; i < m_ncomponents; ++i) {
             m_fractions[i] /= total_mass;
         }
+        m_sampler.Update(m_fractions);
     }
 }
 
@@ -51,6 +52,7 @@ void Material::AddElement(const Element &elm, double fraction) {
         if(!NuGeom::is_close(sum, 1.0, 1e-4)) {
             spdlog::warn("Material: Mass fractions sum to {} and not 1", sum);
         }
+        m_sampler.Update(m_fractions);
     }
 }
 
@@ -74,16 +76,27 @@ void Material::AddMaterial(const Material &mat, double fraction) {
             AddElement(elm, fraction*mat.MassFractions()[idx++]);
         }
     }
+    if(m_elements.size() == m_ncomponents) m_sampler.Update(m_fractions);
 }
 
 NuGeom::Element Material::SelectElement(double ran) const {
     if(m_elements.size() != m_ncomponents)
         throw std::runtime_error("Material does not have the right number of elements!");
 
-    double sum = m_fractions[0];
-    size_t idx = 0;
-    while(true) {
-        if(ran < sum) return m_elements[idx];
-        sum += m_fractions[++idx];
+    return m_elements[m_sampler.Sample(ran)];
+}
+
+NuGeom::Element Material::SelectElement(double ran, const AliasTable &sampler) const {
+    if(sampler.Size() != m_elements.size())
+        throw std::runtime_error("Material: Sampler does not match the number of elements");
+
+    return m_elements[sampler.Sample(ran)];
+}
+
+std::vector<double> Material::NumberFractions() const {
+    std::vector<double> fractions(m_fractions.size());
+    for(size_t i = 0; i < fractions.size(); ++i) {
+        fractions[i] = m_fractions[i]/m_elements[i].Mass();
     }
+    return fractions;
 }
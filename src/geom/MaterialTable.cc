@@ -0,0 +1,42 @@
+#include "geom/MaterialTable.hh"
+#include "fmt/format.h"
+
+#include <limits>
+#include <stdexcept>
+
+using NuGeom::MaterialTable;
+
+MaterialTable::MaterialTable() {
+    Add(Material("", 0, 0));
+}
+
+MaterialTable& MaterialTable::Global() {
+    static MaterialTable table;
+    return table;
+}
+
+NuGeom::MaterialId MaterialTable::Add(const Material &material) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto key = Key(material);
+    auto it = m_ids.find(key);
+    if(it != m_ids.end()) return it -> second;
+
+    if(m_materials.size() > std::numeric_limits<MaterialId>::max())
+        throw std::runtime_error("MaterialTable: Too many materials");
+    auto id = static_cast<MaterialId>(m_materials.size());
+    m_materials.push_back(material);
+    m_ids[key] = id;
+    return id;
+}
+
+std::string MaterialTable::Key(const Material &material) {
+    // Materials are identical if the name, density and composition agree
+    std::string key = fmt::format("{}|{}", material.Name(), material.Density());
+    const auto &elements = material.Elements();
+    const auto &fractions = material.MassFractions();
+    for(size_t i = 0; i < elements.size(); ++i) {
+        key += fmt::format("|{}:{}:{}", elements[i].Id(), elements[i].Mass(),
+                           i < fractions.size() ? fractions[i] : 0.0);
+    }
+    return key;
+}
@@ -0,0 +1,132 @@
+#include "geom/MaxPathLength.hh"
+#include "geom/Parallel.hh"
+#include "geom/Random.hh"
+#include "geom/Utilities.hh"
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+uint64_t CacheKey(const NuGeom::World &world, const NuGeom::FluxWindow &window,
+                  const NuGeom::MaxPathLengthOptions &options) {
+    NuGeom::Hasher hasher;
+    hasher.Add(world.Fingerprint());
+    for(const auto &vec : {window.Corner(), window.EdgeU(), window.EdgeV(), window.Direction()}) {
+        hasher.Add(vec.X()).Add(vec.Y()).Add(vec.Z());
+    }
+    if(window.Source()) hasher.Add(window.Source() -> X()).Add(window.Source() -> Y()).Add(window.Source() -> Z());
+    hasher.Add(options.nu).Add(options.nv).Add(options.nrandom).Add(options.cone_angle)
+          .Add(options.safety_factor).Add(options.seed);
+    return hasher.Value();
+}
+
+std::string CachePath(const std::string &directory, uint64_t key) {
+    return fmt::format("{}/maxpl_{:016x}.txt", directory, key);
+}
+
+/// Reads the cached maxima, returns false if the file is missing or refers to other materials
+bool LoadCache(const std::string &path, uint64_t key, std::vector<double> &maxima) {
+    std::ifstream input(path);
+    if(!input) return false;
+
+    std::string line;
+    if(!std::getline(input, line) || line != fmt::format("# nugeom max path lengths {:016x}", key)) return false;
+    const auto &table = NuGeom::MaterialTable::Global();
+    std::vector<double> result(table.Size(), 0);
+    while(std::getline(input, line)) {
+        // Each line is the material id, the maximum and the name of the material
+        std::istringstream iss(line);
+        NuGeom::MaterialId id;
+        double value;
+        std::string name;
+        if(!(iss >> id >> value)) return false;
+        iss.get();
+        std::getline(iss, name);
+        if(id >= table.Size() || table.Get(id).Name() != name) return false;
+        result[id] = value;
+    }
+    maxima = std::move(result);
+    return true;
+}
+
+void SaveCache(const std::string &path, uint64_t key, const std::vector<double> &maxima) {
+    std::ofstream output(path);
+    if(!output) {
+        spdlog::warn("MaxPathLength: Could not write cache file {}", path);
+        return;
+    }
+    output << fmt::format("# nugeom max path lengths {:016x}\n", key);
+    const auto &table = NuGeom::MaterialTable::Global();
+    for(NuGeom::MaterialId id = 0; id < maxima.size(); ++id) {
+        output << fmt::format("{} {} {}\n", id, maxima[id], table.Get(id).Name());
+    }
+}
+
+/// Direction drawn uniformly in solid angle within the cone around the axis
+NuGeom::Vector3D SampleCone(const NuGeom::Vector3D &axis, double angle, NuGeom::RandomStream &rng) {
+    const double cos_theta = 1 - rng.Uniform()*(1 - std::cos(angle));
+    const double sin_theta = std::sqrt(std::max(0.0, 1 - cos_theta*cos_theta));
+    const double phi = 2*M_PI*rng.Uniform();
+    // Orthonormal basis around the axis
+    const auto helper = std::abs(axis.X()) < 0.9 ? NuGeom::Vector3D{1, 0, 0} : NuGeom::Vector3D{0, 1, 0};
+    const auto e1 = axis.Cross(helper).Unit();
+    const auto e2 = axis.Cross(e1);
+    return cos_theta*axis + sin_theta*(std::cos(phi)*e1 + std::sin(phi)*e2);
+}
+
+}
+
+std::vector<double> NuGeom::MaxPathLengths(const World &world, const FluxWindow &window,
+                                           const MaxPathLengthOptions &options) {
+    const uint64_t key = CacheKey(world, window, options);
+    std::vector<double> maxima;
+    if(!options.cache_directory.empty()) {
+        auto path = CachePath(options.cache_directory, key);
+        if(LoadCache(path, key, maxima)) {
+            spdlog::info("MaxPathLength: Loaded maxima from {}", path);
+            return maxima;
+        }
+    }
+
+    const size_t ngrid = options.nu*options.nv;
+    const size_t nrays = ngrid + options.nrandom;
+    std::vector<std::vector<double>> thread_maxima(ThreadCount(options.nthreads));
+    std::vector<std::vector<double>> columns(thread_maxima.size());
+    ParallelFor(nrays, 1024, thread_maxima.size(), [&](size_t thread, size_t begin, size_t end) {
+        auto &thread_max = thread_maxima[thread];
+        auto &column = columns[thread];
+        for(size_t i = begin; i < end; ++i) {
+            Ray ray;
+            if(i < ngrid) {
+                const double u = (static_cast<double>(i % options.nu) + 0.5)/static_cast<double>(options.nu);
+                const double v = (static_cast<double>(i / options.nu) + 0.5)/static_cast<double>(options.nv);
+                ray = window.GetRay(u, v);
+            } else {
+                RandomStream rng(options.seed, i);
+                const double u = rng.Uniform(), v = rng.Uniform();
+                ray = window.GetRay(u, v);
+                if(options.cone_angle > 0)
+                    ray = Ray(ray.Origin(), SampleCone(ray.Direction(), options.cone_angle, rng));
+            }
+            world.ColumnDensity(ray, column);
+            if(thread_max.size() < column.size()) thread_max.resize(column.size(), 0);
+            for(size_t id = 0; id < column.size(); ++id) thread_max[id] = std::max(thread_max[id], column[id]);
+        }
+    });
+
+    maxima.assign(MaterialTable::Global().Size(), 0);
+    for(const auto &thread_max : thread_maxima) {
+        for(size_t id = 0; id < thread_max.size(); ++id) maxima[id] = std::max(maxima[id], thread_max[id]);
+    }
+    for(auto &value : maxima) value *= options.safety_factor;
+
+    if(!options.cache_directory.empty()) SaveCache(CachePath(options.cache_directory, key), key, maxima);
+    return maxima;
+}
@@ -1,7 +1,11 @@
 #include "geom/Parser.hh"
+#include "geom/Units.hh"
 #include "spdlog/spdlog.h"
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <tuple>
 
 using NuGeom::GDMLParser;
 
@@ -18,9 +22,10 @@ GDMLParser::GDMLParser(const pugi::xml_document &doc) {
     spdlog::info("Number of constants defined: {}", m_def_constants.size());
     spdlog::info("Number of positions defined: {}", m_def_positions.size());
     spdlog::info("Number of rotations defined: {}", m_def_rotations.size());
+    spdlog::info("Number of scales defined: {}", m_def_scales.size());
     spdlog::info("Number of materials: {}", m_materials.size());
-    spdlog::info("Number of solids: {}", m_shapes.size());
-    spdlog::info("Number of volumes: {}", m_volumes.size());
+    spdlog::info("Number of solids: {} ({} unique)", m_shapes.size(), m_shape_cache.size());
+    spdlog::info("Number of volumes: {} ({} unique)", m_volumes.size(), m_volume_cache.size());
     spdlog::info("Number of physical volumes: {}", m_phys_vols.size());
 }
 
@@ -45,6 +50,27 @@ NuGeom::Transform3D GDMLParser::GetTransform(const std::string &name) const {
     return m_def_rotations.at(name);
 }
 
+NuGeom::Scale3D GDMLParser::GetScale(const std::string &name) const {
+    if(m_def_scales.find(name) == m_def_scales.end())
+        throw std::runtime_error(fmt::format("GDMLParser: Undefined scale {}", name));
+
+    return m_def_scales.at(name);
+}
+
+std::shared_ptr<NuGeom::Shape> GDMLParser::GetShape(const std::string &name) const {
+    if(m_shapes.find(name) == m_shapes.end())
+        throw std::runtime_error(fmt::format("GDMLParser: Undefined solid {}", name));
+
+    return m_shapes.at(name);
+}
+
+std::shared_ptr<NuGeom::LogicalVolume> GDMLParser::GetVolume(const std::string &name) const {
+    if(m_volumes.find(name) == m_volumes.end())
+        throw std::runtime_error(fmt::format("GDMLParser: Undefined volume {}", name));
+
+    return m_volumes.at(name);
+}
+
 NuGeom::Material GDMLParser::GetMaterial(const std::string &name) const {
     if(m_materials.find(name) == m_materials.end())
         throw std::runtime_error(fmt::format("GDMLParser: Undefined material {}", name));
@@ -76,9 +102,9 @@ void GDMLParser::ParseDefines(const pugi::xml_node &define) {
         // Convert the units
         std::string unit = node.attribute("unit").value();
         if(unit == "m") {
-            position *= 100; 
+            position *= Units::m;
         } else if(unit == "mm") {
-            position /= 10;
+            position *= Units::mm;
         }
         m_def_positions[name] = position;
     }
@@ -93,15 +119,21 @@ void GDMLParser::ParseDefines(const pugi::xml_node &define) {
 
         // Convert if needed
         double convert{};
-        if(unit == "deg") convert = M_PI/180;
+        if(unit == "deg") convert = Units::deg;
         else if(unit == "rad") convert = 1;
         else throw std::runtime_error("GDMLParser: Invalid angle unit");
-        auto rotX = RotationX3D(xRot*convert); 
-        auto rotY = RotationY3D(yRot*convert); 
-        auto rotZ = RotationZ3D(zRot*convert); 
-        Transform3D rot = rotZ*rotY*rotX;
+        Transform3D rot = Quaternion::FromEuler(xRot*convert, yRot*convert, zRot*convert).ToRotation();
         m_def_rotations[name] = rot;
     }
+
+    for(const auto &node : define.children("scale")) {
+        // Load the scale information (dimensionless)
+        std::string name = node.attribute("name").value();
+        double x = node.attribute("x").as_double(1);
+        double y = node.attribute("y").as_double(1);
+        double z = node.attribute("z").as_double(1);
+        m_def_scales[name] = Scale3D(x, y, z);
+    }
 }
 
 void GDMLParser::ParseMaterials(const pugi::xml_node &materials) {
@@ -110,7 +142,7 @@ void GDMLParser::ParseMaterials(const pugi::xml_node &materials) {
         std::string symbol = node.attribute("formula").value();
         size_t z = node.attribute("Z").as_ullong();
         double mass = node.child("atom").attribute("value").as_double();
-        Element elm(name, symbol, z, mass);
+        m_elements[name] = Element(name, symbol, z, mass);
     }
 
     for(const auto &node : materials.children("material")) {
@@ -132,8 +164,7 @@ void GDMLParser::ParseMaterials(const pugi::xml_node &materials) {
                 if(m_materials.find(element.attribute("ref").as_string()) != m_materials.end()) {
                     material.AddMaterial(m_materials[element.attribute("ref").as_string()], fraction);         
                 } else {
-                    Element elm(element.attribute("ref").as_string());
-                    material.AddElement(elm, fraction);
+                    material.AddElement(GetElement(element.attribute("ref").as_string()), fraction);
                 }
             }
             m_materials[name] = material;
@@ -147,7 +178,7 @@ void GDMLParser::ParseMaterials(const pugi::xml_node &materials) {
                 if(m_materials.find(element.attribute("ref").as_string()) != m_materials.end()) {
                     throw std::runtime_error("GDMLParser: Using composite materials requires mass fractions");
                 } else {
-                    Element elm(element.attribute("ref").as_string());
+                    const auto &elm = GetElement(element.attribute("ref").as_string());
                     if(natoms < 1) {
                         material.AddElement(elm, natoms);
                     } else {
@@ -162,9 +193,23 @@ void GDMLParser::ParseMaterials(const pugi::xml_node &materials) {
     }
 }
 
+const NuGeom::Element& GDMLParser::GetElement(const std::string &name) {
+    auto it = m_elements.find(name);
+    // Elements not defined in the file come from the user defined elements or the periodic table
+    if(it == m_elements.end()) it = m_elements.emplace(name, Element(name)).first;
+    return it -> second;
+}
+
 void GDMLParser::ParseSolids(const pugi::xml_node &solids) {
     for(const auto &solid : solids) {
         std::string name = solid.attribute("name").value();
+        // Reuse an identical solid if one has already been created
+        std::string key = SolidKey(solid);
+        if(m_shape_cache.find(key) != m_shape_cache.end()) {
+            m_shapes[name] = m_shape_cache[key];
+            continue;
+        }
+
         // TODO: Implement csg solids
         if(std::strcmp(solid.name(), "subtraction") == 0) {
             std::string first_name = solid.child("first").attribute("ref").value();
@@ -187,11 +232,88 @@ void GDMLParser::ParseSolids(const pugi::xml_node &solids) {
             auto second_shape = m_shapes[second_name];
             auto shape = std::make_shared<CombinedShape>(first_shape, second_shape, ShapeBinaryOp::kIntersect);
             m_shapes[name] = shape;
+        } else if(std::strcmp(solid.name(), "scaledSolid") == 0) {
+            std::string solid_name = solid.child("solidref").attribute("ref").value();
+            Scale3D scale;
+            if(solid.child("scaleref")) {
+                scale = GetScale(solid.child("scaleref").attribute("ref").value());
+            } else if(solid.child("scale")) {
+                auto scale_node = solid.child("scale");
+                scale = Scale3D(scale_node.attribute("x").as_double(1),
+                                scale_node.attribute("y").as_double(1),
+                                scale_node.attribute("z").as_double(1));
+            }
+            auto shape = std::make_shared<ScaledShape>(m_shapes[solid_name], scale);
+            m_shapes[name] = shape;
+        } else if(std::strcmp(solid.name(), "reflectedSolid") == 0) {
+            std::string solid_name = solid.attribute("solid").value();
+            Scale3D scale(solid.attribute("sx").as_double(1),
+                          solid.attribute("sy").as_double(1),
+                          solid.attribute("sz").as_double(1));
+
+            // Convert the units
+            double convert = 1;
+            std::string aunit = solid.attribute("aunit").value();
+            if(aunit == "deg") convert = Units::deg;
+            Rotation3D rotation = Quaternion::FromEuler(solid.attribute("rx").as_double()*convert,
+                                                        solid.attribute("ry").as_double()*convert,
+                                                        solid.attribute("rz").as_double()*convert).ToRotation();
+
+            Vector3D translation(solid.attribute("dx").as_double(),
+                                 solid.attribute("dy").as_double(),
+                                 solid.attribute("dz").as_double());
+            std::string lunit = solid.attribute("lunit").value();
+            if(lunit == "m") {
+                translation *= Units::m;
+            } else if(lunit == "mm") {
+                translation *= Units::mm;
+            }
+
+            auto shape = std::make_shared<ScaledShape>(m_shapes[solid_name], scale, rotation,
+                                                       Translation3D(translation));
+            m_shapes[name] = shape;
         } else {
             std::shared_ptr<Shape> shape = ShapeFactory::Initialize(solid.name(), solid); 
             m_shapes[name] = shape;
         }
+        m_shape_cache[key] = m_shapes[name];
+    }
+}
+
+std::string GDMLParser::SolidKey(const pugi::xml_node &solid) const {
+    // Attributes referring to other solids are replaced by the (already interned) solid,
+    // so that solids built from identical components share a key even if named differently
+    auto append_attributes = [this](std::string &key, const pugi::xml_node &node) {
+        std::vector<std::pair<std::string, std::string>> attributes;
+        for(const auto &attr : node.attributes()) {
+            std::string attr_name = attr.name();
+            if(attr_name == "name") continue;
+            std::string value = attr.value();
+            bool is_solid_ref = attr_name == "solid"
+                || (attr_name == "ref" && (std::strcmp(node.name(), "first") == 0
+                                           || std::strcmp(node.name(), "second") == 0
+                                           || std::strcmp(node.name(), "solidref") == 0));
+            char *end = nullptr;
+            double number = std::strtod(value.c_str(), &end);
+            if(is_solid_ref && m_shapes.find(value) != m_shapes.end()) {
+                value = fmt::format("@{}", static_cast<const void*>(m_shapes.at(value).get()));
+            } else if(!value.empty() && *end == '\0') {
+                value = fmt::format("{}", number);
+            }
+            attributes.emplace_back(attr_name, value);
+        }
+        std::sort(attributes.begin(), attributes.end());
+        for(const auto &attr : attributes) key += fmt::format(" {}={}", attr.first, attr.second);
+    };
+
+    std::string key = solid.name();
+    append_attributes(key, solid);
+    for(const auto &child : solid.children()) {
+        key += fmt::format(" <{}", child.name());
+        append_attributes(key, child);
+        key += ">";
     }
+    return key;
 }
 
 void GDMLParser::ParseStructure(const pugi::xml_node &structure) {
@@ -201,9 +323,9 @@ void GDMLParser::ParseStructure(const pugi::xml_node &structure) {
         std::string solid_ref = node.child("solidref").attribute("ref").value();
         Material material = m_materials[material_ref];
         auto shape = m_shapes[solid_ref];
-        auto volume = std::make_shared<LogicalVolume>(material, shape);
-        
+
         // Check for sub-volumes
+        std::vector<std::tuple<std::shared_ptr<LogicalVolume>, Translation3D, Transform3D>> placements;
         for(const auto &subnode : node.children("physvol")) {
             std::string volume_ref = subnode.child("volumeref").attribute("ref").value();
 
@@ -212,17 +334,18 @@ void GDMLParser::ParseStructure(const pugi::xml_node &structure) {
                 std::string position_ref = subnode.child("positionref").attribute("ref").value();
                 translation = m_def_positions[position_ref];
             } else if(subnode.child("position")) {
-                double x = subnode.attribute("x").as_double();
-                double y = subnode.attribute("y").as_double();
-                double z = subnode.attribute("z").as_double();
+                auto position = subnode.child("position");
+                double x = position.attribute("x").as_double();
+                double y = position.attribute("y").as_double();
+                double z = position.attribute("z").as_double();
                 translation = Vector3D(x, y, z);
 
                 // Convert the units
-                std::string unit = subnode.attribute("unit").value();
+                std::string unit = position.attribute("unit").value();
                 if(unit == "m") {
-                    translation *= 100; 
+                    translation *= Units::m;
                 } else if(unit == "mm") {
-                    translation /= 10;
+                    translation *= Units::mm;
                 }
             }
 
@@ -230,27 +353,43 @@ void GDMLParser::ParseStructure(const pugi::xml_node &structure) {
             if(subnode.child("rotationref")) {
                 rotation = m_def_rotations[subnode.child("rotationref").attribute("ref").value()];
             } else if(subnode.child("rotation")) {
-                double xRot = node.attribute("x").as_double();
-                double yRot = node.attribute("y").as_double();
-                double zRot = node.attribute("z").as_double();
+                auto rotation_node = subnode.child("rotation");
+                double xRot = rotation_node.attribute("x").as_double();
+                double yRot = rotation_node.attribute("y").as_double();
+                double zRot = rotation_node.attribute("z").as_double();
 
                 // Convert if needed
                 double convert = 1;
-                if(subnode.attribute("unit")) {
-                    std::string unit = subnode.attribute("unit").value();
-                    if(unit == "deg") convert = M_PI/180;
+                if(rotation_node.attribute("unit")) {
+                    std::string unit = rotation_node.attribute("unit").value();
+                    if(unit == "deg") convert = Units::deg;
                     else if(unit == "rad") convert = 1;
                     else throw std::runtime_error("GDMLParser: Invalid angle unit: " + unit);
                 }
-                auto rotX = RotationX3D(xRot*convert); 
-                auto rotY = RotationY3D(yRot*convert); 
-                auto rotZ = RotationZ3D(zRot*convert); 
-                rotation = rotZ*rotY*rotX;
+                rotation = Quaternion::FromEuler(xRot*convert, yRot*convert, zRot*convert).ToRotation();
             }
 
-            auto subvolume = m_volumes[volume_ref];
+            placements.emplace_back(m_volumes[volume_ref], Translation3D(translation), rotation);
+        }
+
+        // Reuse an identical volume (same solid, material, and daughter placements) if one exists
+        std::string key = fmt::format("{}|{}", static_cast<const void*>(shape.get()), material_ref);
+        for(const auto &placement : placements) {
+            key += fmt::format("|{}", static_cast<const void*>(std::get<0>(placement).get()));
+            for(const auto &elm : (std::get<2>(placement)*std::get<1>(placement)).GetTransform())
+                key += fmt::format(",{}", elm);
+        }
+        if(m_volume_cache.find(key) != m_volume_cache.end()) {
+            spdlog::info("Volume: {} (shared)", name);
+            m_volumes[name] = m_volume_cache[key];
+            continue;
+        }
+
+        auto volume = std::make_shared<LogicalVolume>(material, shape);
+        for(const auto &placement : placements) {
+            auto subvolume = std::get<0>(placement);
             subvolume -> SetMother(volume);
-            auto phys_vol = std::make_shared<PhysicalVolume>(subvolume, Translation3D(translation), rotation);
+            auto phys_vol = std::make_shared<PhysicalVolume>(subvolume, std::get<1>(placement), std::get<2>(placement));
             m_phys_vols.push_back(phys_vol);
             volume -> AddDaughter(m_phys_vols.back());
         }
@@ -259,5 +398,6 @@ void GDMLParser::ParseStructure(const pugi::xml_node &structure) {
         spdlog::info("  Mass = {}", volume -> Mass());
         // Store volume information
         m_volumes[name] = volume;
+        m_volume_cache[key] = volume;
     }
 }
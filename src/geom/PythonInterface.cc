@@ -10,6 +10,8 @@
 #include "geom/Element.hh"
 #include "geom/Material.hh"
 #include "geom/Camera.hh"
+#include "geom/DensityMap.hh"
+#include "geom/FluxWindow.hh"
 
 PYBIND11_MODULE(nugeom, m) {
     // XML Parser module
@@ -118,7 +120,7 @@ void TransformModule(py::module &m) {
                       double, double, double, double,
                       double, double, double, double>())
         .def(py::init<const NuGeom::Rotation3D&, const NuGeom::Translation3D&>())
-        .def("apply", &NuGeom::Transform3D::Apply)
+        .def("apply", py::overload_cast<const NuGeom::Vector3D&>(&NuGeom::Transform3D::Apply, py::const_))
         .def("inverse", &NuGeom::Transform3D::Inverse)
         .def(py::self * py::self)
         .def("decompose", &NuGeom::Transform3D::Decompose);
@@ -176,6 +178,7 @@ void ElementModule(py::module &m) {
     py::class_<NuGeom::Element>(m, "Element")
         .def(py::init<>())
         .def(py::init<const std::string&>())
+        .def(py::init<NuGeom::ElementId>(), py::arg("Z"))
         .def(py::init<const std::string&, size_t, double, size_t>(),
              py::arg("name"), py::arg("Z"), py::arg("mass"), py::arg("A") = 0)
         .def(py::init<const std::string&, const std::string&, size_t, double, size_t>(),
@@ -187,6 +190,7 @@ void ElementModule(py::module &m) {
         .def("nprotons", &NuGeom::Element::Z)
         .def("nnucleons", &NuGeom::Element::A)
         .def("mass", &NuGeom::Element::Mass)
+        .def("id", &NuGeom::Element::Id)
         .def_static("common_elements", &NuGeom::Element::CommonElements);
 }
 
@@ -201,7 +205,8 @@ void MaterialModule(py::module &m) {
         .def("add_element", py::overload_cast<const NuGeom::Element&, int>(&NuGeom::Material::AddElement))
         .def("add_element", py::overload_cast<const NuGeom::Element&, double>(&NuGeom::Material::AddElement))
         .def("add_material", &NuGeom::Material::AddMaterial)
-        .def("select_element", &NuGeom::Material::SelectElement)
+        .def("select_element", py::overload_cast<double>(&NuGeom::Material::SelectElement, py::const_))
+        .def("number_fractions", &NuGeom::Material::NumberFractions)
         .def("density", &NuGeom::Material::Density)
         .def("name", &NuGeom::Material::Name);
 }
@@ -258,5 +263,27 @@ void WorldModule(py::module &m) {
         .def("get_material", &NuGeom::World::GetMaterial)
         .def("in_world", &NuGeom::World::InWorld)
         .def("sphere_trace", &NuGeom::World::SphereTrace)
-        .def("line_segments", &NuGeom::World::GetLineSegments);
+        .def("line_segments", py::overload_cast<const NuGeom::Ray&>(&NuGeom::World::GetLineSegments, py::const_));
+
+    py::class_<NuGeom::FluxWindow>(m, "FluxWindow")
+        .def(py::init<const NuGeom::Vector3D&, const NuGeom::Vector3D&, const NuGeom::Vector3D&,
+                      const NuGeom::Vector3D&>())
+        .def_static("from_point_source", &NuGeom::FluxWindow::FromPointSource)
+        .def("area", &NuGeom::FluxWindow::Area)
+        .def("point", &NuGeom::FluxWindow::Point)
+        .def("get_ray", &NuGeom::FluxWindow::GetRay);
+
+    py::class_<NuGeom::DensityMap>(m, "DensityMap")
+        .def_static("trace", &NuGeom::DensityMap::Trace,
+                    py::arg("world"), py::arg("window"), py::arg("nu"), py::arg("nv"), py::arg("nthreads")=0)
+        .def_static("read", &NuGeom::DensityMap::Read)
+        .def("nu", &NuGeom::DensityMap::NU)
+        .def("nv", &NuGeom::DensityMap::NV)
+        .def("material_names", &NuGeom::DensityMap::MaterialNames)
+        .def("total", &NuGeom::DensityMap::Total)
+        .def("density", &NuGeom::DensityMap::Density)
+        .def("totals", &NuGeom::DensityMap::Totals)
+        .def("densities", &NuGeom::DensityMap::Densities)
+        .def("write", &NuGeom::DensityMap::Write)
+        .def("write_png", &NuGeom::DensityMap::WritePNG, py::arg("filename"), py::arg("id")=py::none());
 }
@@ -0,0 +1,68 @@
+#include "geom/Quaternion.hh"
+
+#include <cmath>
+#include <stdexcept>
+
+using NuGeom::Quaternion;
+using NuGeom::RigidTransform3D;
+
+Quaternion Quaternion::FromAxisAngle(const Vector3D &vec, double angle) {
+    // Ensure the vector is a unit vector
+    auto axis = vec.Unit();
+    double sina = std::sin(angle/2);
+    return {std::cos(angle/2), axis.X()*sina, axis.Y()*sina, axis.Z()*sina};
+}
+
+Quaternion Quaternion::FromEuler(double x, double y, double z) {
+    return FromAxisAngle(UnitZ, z)*FromAxisAngle(UnitY, y)*FromAxisAngle(UnitX, x);
+}
+
+Quaternion Quaternion::FromRotation(const Transform3D &transform) {
+    // Branch on the largest diagonal term to keep the square root away from zero
+    const auto m = transform.GetTransform();
+    const double trace = m[0] + m[5] + m[10];
+    if(trace > 0) {
+        double s = 2*std::sqrt(1 + trace);
+        return Quaternion{s/4, (m[9] - m[6])/s, (m[2] - m[8])/s, (m[4] - m[1])/s}.Unit();
+    } else if(m[0] > m[5] && m[0] > m[10]) {
+        double s = 2*std::sqrt(1 + m[0] - m[5] - m[10]);
+        return Quaternion{(m[9] - m[6])/s, s/4, (m[1] + m[4])/s, (m[2] + m[8])/s}.Unit();
+    } else if(m[5] > m[10]) {
+        double s = 2*std::sqrt(1 + m[5] - m[0] - m[10]);
+        return Quaternion{(m[2] - m[8])/s, (m[1] + m[4])/s, s/4, (m[6] + m[9])/s}.Unit();
+    }
+    double s = 2*std::sqrt(1 + m[10] - m[0] - m[5]);
+    return Quaternion{(m[4] - m[1])/s, (m[2] + m[8])/s, (m[6] + m[9])/s, s/4}.Unit();
+}
+
+NuGeom::Rotation3D Quaternion::ToRotation() const {
+    const double xx = m_x*m_x, yy = m_y*m_y, zz = m_z*m_z;
+    const double xy = m_x*m_y, xz = m_x*m_z, yz = m_y*m_z;
+    const double wx = m_w*m_x, wy = m_w*m_y, wz = m_w*m_z;
+    return Transform3D{1 - 2*(yy + zz), 2*(xy - wz), 2*(xz + wy), 0,
+                       2*(xy + wz), 1 - 2*(xx + zz), 2*(yz - wx), 0,
+                       2*(xz - wy), 2*(yz + wx), 1 - 2*(xx + yy), 0};
+}
+
+RigidTransform3D::RigidTransform3D(const Transform3D &transform) {
+    if(!IsRigid(transform))
+        throw std::runtime_error("RigidTransform3D: Transform is not a rotation and translation");
+
+    const auto kind = transform.GetKind();
+    const auto mat = transform.GetTransform();
+    m_translation = {mat[3], mat[7], mat[11]};
+    if(kind == Transform3D::Kind::Rotation || kind == Transform3D::Kind::RotationTranslation)
+        m_rotation = Quaternion::FromRotation(transform);
+}
+
+bool RigidTransform3D::IsRigid(const Transform3D &transform) {
+    const auto mat = transform.GetTransform();
+    const double det = mat[0]*(mat[5]*mat[10] - mat[6]*mat[9])
+                     - mat[1]*(mat[4]*mat[10] - mat[6]*mat[8])
+                     + mat[2]*(mat[4]*mat[9] - mat[5]*mat[8]);
+    return transform.GetKind() != Transform3D::Kind::General && det >= 0;
+}
+
+NuGeom::Transform3D RigidTransform3D::ToTransform() const {
+    return Transform3D(m_rotation.ToRotation(), Translation3D(m_translation));
+}
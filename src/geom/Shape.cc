@@ -2,10 +2,13 @@
 #include "geom/Vector2D.hh"
 #include "geom/Vector3D.hh"
 #include "geom/Ray.hh"
+#include "geom/Units.hh"
+#include "geom/Utilities.hh"
 #include "pugixml.hpp"
 #include "spdlog/spdlog.h"
 #include <limits>
 #include <algorithm>
+#include <stdexcept>
 
 NuGeom::Location NuGeom::Shape::Contains(const Vector3D &point) const {
     double dist = SignedDistance(point);
@@ -20,24 +23,33 @@ NuGeom::Vector3D NuGeom::Shape::TransformPoint(const Vector3D &point) const {
 
 NuGeom::Ray NuGeom::Shape::TransformRay(const Ray &in_ray) const {
     auto origin = m_rotation.Apply(m_translation.Apply(in_ray.Origin())); 
-    auto direction = m_rotation.Apply(in_ray.Direction());
-    return {origin, direction};
+    auto direction = m_rotation.ApplyDirection(in_ray.Direction());
+    return {origin, direction, false, in_ray.MaxDistance()};
 }
 
 
 double NuGeom::Shape::Intersect(const Ray &in_ray) const {
     auto ray = identity_transform ? in_ray : TransformRay(in_ray);
-    return IntersectImpl(ray);
+    double time = IntersectImpl(ray);
+    return time <= in_ray.MaxDistance() ? time : std::numeric_limits<double>::infinity();
 }
 
 std::pair<double, double> NuGeom::Shape::SolveQuadratic(double a, double b, double c) const {
-    const double det = b*b - 4*a*c;
-    if(det < 0) return {std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
-    double t1 = 2*c/(-b-sqrt(det));
-    double t2 = 2*c/(-b+sqrt(det));
-    t1 = t1 > 0 ? t1 : std::numeric_limits<double>::infinity();
-    t2 = t2 > 0 ? t2 : std::numeric_limits<double>::infinity();
-    return {t1, t2};
+    return Kernel::SolveQuadratic(a, b, c);
+}
+
+double NuGeom::Kernel::GenericSignedDistance(const Shape *shape, const Vector3D &point) {
+    return shape -> SignedDistance(point);
+}
+
+double NuGeom::Kernel::GenericIntersect(const Shape *shape, const Ray &ray) {
+    return shape -> Intersect(ray);
+}
+
+void NuGeom::Shape::Hash(Hasher &hasher) const {
+    hasher.Add(ShapeName());
+    for(const auto &entry : m_rotation.GetTransform()) hasher.Add(entry);
+    for(const auto &entry : m_translation.GetTransform()) hasher.Add(entry);
 }
 
 // TODO: Do this correctly!!!!
@@ -92,6 +104,52 @@ double NuGeom::CombinedShape::Volume() const {
     return 0;
 }
 
+void NuGeom::CombinedShape::Hash(Hasher &hasher) const {
+    Shape::Hash(hasher);
+    hasher.Add(static_cast<int>(m_op));
+    m_left -> Hash(hasher);
+    m_right -> Hash(hasher);
+}
+
+NuGeom::ScaledShape::ScaledShape(std::shared_ptr<Shape> shape, const Scale3D &scale,
+                                 const Rotation3D &rotation, const Translation3D &translation)
+    : Shape(rotation, translation), m_shape{std::move(shape)}, m_scale{scale.Factors()} {
+    if(m_scale.X() == 0 || m_scale.Y() == 0 || m_scale.Z() == 0)
+        throw std::runtime_error("ScaledShape: Scale factors must be non-zero");
+    m_inv_scale = 1.0/m_scale;
+    m_min_scale = std::min(std::abs(m_scale.X()), std::min(std::abs(m_scale.Y()), std::abs(m_scale.Z())));
+}
+
+double NuGeom::ScaledShape::SignedDistance(const Vector3D &in_point) const {
+    auto point = TransformPoint(in_point);
+    Vector3D local{point.X()*m_inv_scale.X(), point.Y()*m_inv_scale.Y(), point.Z()*m_inv_scale.Z()};
+    // Scaling by the smallest factor gives a bound on the true distance,
+    // which is exact for uniform scales and safe for sphere tracing otherwise
+    return m_shape -> SignedDistance(local) * m_min_scale;
+}
+
+double NuGeom::ScaledShape::IntersectImpl(const Ray &ray) const {
+    Vector3D origin{ray.Origin().X()*m_inv_scale.X(),
+                    ray.Origin().Y()*m_inv_scale.Y(),
+                    ray.Origin().Z()*m_inv_scale.Z()};
+    Vector3D direction{ray.Direction().X()*m_inv_scale.X(),
+                       ray.Direction().Y()*m_inv_scale.Y(),
+                       ray.Direction().Z()*m_inv_scale.Z()};
+    // The unscaled shape sees a unit direction, so convert the local time back
+    const double length = direction.Norm();
+    return m_shape -> Intersect(Ray(origin, direction/length, false)) / length;
+}
+
+double NuGeom::ScaledShape::Volume() const {
+    return m_shape -> Volume() * std::abs(m_scale.X()*m_scale.Y()*m_scale.Z());
+}
+
+void NuGeom::ScaledShape::Hash(Hasher &hasher) const {
+    Shape::Hash(hasher);
+    hasher.Add(m_scale.X()).Add(m_scale.Y()).Add(m_scale.Z());
+    m_shape -> Hash(hasher);
+}
+
 std::unique_ptr<NuGeom::Shape> NuGeom::Box::Construct(const pugi::xml_node &node) {
     // Load the box parameters
     double x = node.attribute("x").as_double();
@@ -102,44 +160,26 @@ std::unique_ptr<NuGeom::Shape> NuGeom::Box::Construct(const pugi::xml_node &node
     // Convert the units
     std::string unit = node.attribute("unit").value();
     if(unit == "m") {
-        params *= 100; 
+        params *= Units::m;
     } else if(unit == "mm") {
-        params /= 10;
+        params *= Units::mm;
     }
 
     return std::make_unique<NuGeom::Box>(params);
 }
 
+void NuGeom::Box::Hash(Hasher &hasher) const {
+    Shape::Hash(hasher);
+    hasher.Add(m_params.X()).Add(m_params.Y()).Add(m_params.Z());
+}
+
 double NuGeom::Box::SignedDistance(const Vector3D &in_point) const {
     auto point = TransformPoint(in_point);
-    Vector3D q = point.Abs() - m_params;
-    return q.Max().Norm() + std::min(q.MaxComponent(), 0.0);
+    return Kernel::BoxSignedDistance(m_params, point);
 }
 
 double NuGeom::Box::IntersectImpl(const Ray &ray) const {
-    // Calculate intersection with all planes
-    const double tx1 = (-m_params.X() - ray.Origin().X())/ray.Direction().X();
-    const double tx2 = (m_params.X() - ray.Origin().X())/ray.Direction().X();
-    const double ty1 = (-m_params.Y() - ray.Origin().Y())/ray.Direction().Y();
-    const double ty2 = (m_params.Y() - ray.Origin().Y())/ray.Direction().Y();
-    const double tz1 = (-m_params.Z() - ray.Origin().Z())/ray.Direction().Z();
-    const double tz2 = (m_params.Z() - ray.Origin().Z())/ray.Direction().Z();
-    const auto tx = std::minmax(tx1, tx2);
-    const auto ty = std::minmax(ty1, ty2);
-    const auto tz = std::minmax(tz1, tz2);
-
-    // Find intersection in x and y direction first
-    double tmin, tmax;
-    if(tx.first > ty.second || ty.first > tx.second) return std::numeric_limits<double>::infinity();
-    tmin = std::max(tx.first, ty.first);
-    tmax = std::min(tx.second, ty.second);
-
-    // Find intersection in z direction
-    if(tmin > tz.second || tz.first > tmax) return std::numeric_limits<double>::infinity();
-    tmin = std::max(tmin, tz.first);
-    tmax = std::min(tmax, tz.second);
-
-    return tmin > 0 ? tmin : tmax > 0 ? tmax : std::numeric_limits<double>::infinity();
+    return Kernel::BoxIntersect(m_params, ray);
 }
 
 std::unique_ptr<NuGeom::Shape> NuGeom::Sphere::Construct(const pugi::xml_node &node) {
@@ -149,72 +189,58 @@ std::unique_ptr<NuGeom::Shape> NuGeom::Sphere::Construct(const pugi::xml_node &n
     // Convert the units
     std::string unit = node.attribute("unit").value();
     if(unit == "m") {
-        radius *= 100; 
+        radius *= Units::m;
     } else if(unit == "mm") {
-        radius /= 10;
+        radius *= Units::mm;
     }
 
     return std::make_unique<NuGeom::Sphere>(radius);
 }
 
+void NuGeom::Sphere::Hash(Hasher &hasher) const {
+    Shape::Hash(hasher);
+    hasher.Add(m_radius);
+}
+
 double NuGeom::Sphere::SignedDistance(const Vector3D &in_point) const {
     auto point = TransformPoint(in_point);
-    return point.Norm() - m_radius;
+    return Kernel::SphereSignedDistance(m_radius, point);
 }
 
 double NuGeom::Sphere::IntersectImpl(const Ray &ray) const {
-    const double a = ray.Direction()*ray.Direction();
-    const double b = 2*ray.Origin()*ray.Direction();
-    const double c = ray.Origin()*ray.Origin() - m_radius;
-    auto intersects = SolveQuadratic(a, b, c);
-    return std::min(intersects.first, intersects.second);
+    return Kernel::SphereIntersect(m_radius, ray);
 }
 
 // TODO: Handle deltaphi and rmin??
 std::unique_ptr<NuGeom::Shape> NuGeom::Cylinder::Construct(const pugi::xml_node &node) {
     // Load the box parameters
     double radius = node.attribute("rmax").as_double();
-    double height = node.attribute("z").as_double();
+    // GDML gives the full length of the tube along z
+    double height = node.attribute("z").as_double()/2;
 
     // Convert the units
     std::string unit = node.attribute("unit").value();
     if(unit == "m") {
-        height *= 100;
-        radius *= 100; 
+        height *= Units::m;
+        radius *= Units::m;
     } else if(unit == "mm") {
-        radius /= 10;
-        height /= 10;
+        radius *= Units::mm;
+        height *= Units::mm;
     }
 
     return std::make_unique<NuGeom::Cylinder>(radius, height);
 }
 
+void NuGeom::Cylinder::Hash(Hasher &hasher) const {
+    Shape::Hash(hasher);
+    hasher.Add(m_radius).Add(m_height);
+}
+
 double NuGeom::Cylinder::SignedDistance(const Vector3D &in_point) const {
     auto point = TransformPoint(in_point);
-    Vector2D q = Vector2D(Vector2D(point.X(), point.Y()).Norm(), std::abs(point.Z())) - Vector2D(m_radius, m_height);
-    return q.Max().Norm() + std::min(q.MaxComponent(), 0.0);
+    return Kernel::CylinderSignedDistance(m_radius, m_height, point);
 }
 
 double NuGeom::Cylinder::IntersectImpl(const Ray &ray) const {
-    const double a = ray.Direction().X()*ray.Direction().X() + ray.Direction().Y()*ray.Direction().Y();
-    const double b = 2*ray.Direction().X()*ray.Origin().X() + 2*ray.Direction().Y()*ray.Origin().Y();
-    const double c = ray.Origin().X()*ray.Origin().X() + ray.Origin().Y()*ray.Origin().Y() - m_radius;
-    auto intersects = SolveQuadratic(a, b, c);
-    // Ensure the ray does not pass below or above finite cylinder
-    double z1 = std::numeric_limits<double>::infinity(), z2 = std::numeric_limits<double>::infinity();
-    if(intersects.first != std::numeric_limits<double>::infinity()) {
-        z1 = ray.Origin().Z() + intersects.first*ray.Direction().Z();
-        if(z1 < 0 || z1 > m_height) intersects.first = std::numeric_limits<double>::infinity();
-    }
-    if(intersects.second != std::numeric_limits<double>::infinity()) {
-        z2 = ray.Origin().Z() + intersects.second*ray.Direction().Z();
-        if(z2 < 0 || z2 > m_height) intersects.second = std::numeric_limits<double>::infinity();
-    }
-    // Calculate the time for the intersection with the endcaps if ray passes through the endcaps
-    double t3 = z1*z2 < 0 ? -ray.Origin().Z()/ray.Direction().Z() : std::numeric_limits<double>::infinity();
-    double t4 = (z1-m_height)*(z2-m_height) < 0 ? (m_height-ray.Origin().Z())/ray.Direction().Z()
-                : std::numeric_limits<double>::infinity();
-    t3 = t3 > 0 ? t3 : std::numeric_limits<double>::infinity();
-    t4 = t4 > 0 ? t4 : std::numeric_limits<double>::infinity();
-    return std::min(std::min(std::min(intersects.first, intersects.second), t3), t4);
+    return Kernel::CylinderIntersect(m_radius, m_height, ray);
 }
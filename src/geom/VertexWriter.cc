@@ -0,0 +1,170 @@
+#include "geom/VertexWriter.hh"
+#include "geom/Interface.hh"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+/// Calls func(name, column) for each column of the vertex files, in the order they are stored
+template<typename Columns, typename Func>
+void ForEachColumn(Columns &columns, const Func &func) {
+    func("x", columns.x);
+    func("y", columns.y);
+    func("z", columns.z);
+    func("material", columns.material);
+    func("Z", columns.Z);
+    func("A", columns.A);
+    func("weight", columns.weight);
+    func("event", columns.event);
+}
+
+/// Type of a column in the notation of numpy, e.g. "<f8" for a little endian double
+template<typename T>
+std::string DType() {
+    const uint16_t one = 1;
+    char first_byte{};
+    std::memcpy(&first_byte, &one, 1);
+    const char kind = std::is_floating_point_v<T> ? 'f' : std::is_signed_v<T> ? 'i' : 'u';
+    return std::string{first_byte == 1 ? '<' : '>', kind} + std::to_string(sizeof(T));
+}
+
+void WriteUInt64(std::ostream &output, uint64_t value) {
+    output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteString(std::ostream &output, const std::string &str) {
+    WriteUInt64(output, str.size());
+    output.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+uint64_t ReadUInt64(std::istream &input) {
+    uint64_t value{};
+    input.read(reinterpret_cast<char*>(&value), sizeof(value));
+    if(!input) throw std::runtime_error("VertexWriter: Unexpected end of file");
+    return value;
+}
+
+std::string ReadString(std::istream &input) {
+    std::string str(ReadUInt64(input), '\0');
+    input.read(str.data(), static_cast<std::streamsize>(str.size()));
+    if(!input) throw std::runtime_error("VertexWriter: Unexpected end of file");
+    return str;
+}
+
+}
+
+void NuGeom::VertexColumns::Reserve(size_t size) {
+    ForEachColumn(*this, [size](const char*, auto &column) { column.reserve(size); });
+}
+
+void NuGeom::VertexColumns::Clear() {
+    ForEachColumn(*this, [](const char*, auto &column) { column.clear(); });
+}
+
+NuGeom::VertexWriter::VertexWriter(const std::string &filename, size_t nthreads, size_t block_size)
+    : m_filename{filename}, m_output{filename, std::ios::binary},
+      m_buffers(std::max<size_t>(nthreads, 1)), m_block_size{std::max<size_t>(block_size, 1)} {
+    if(!m_output) throw std::runtime_error("VertexWriter: Could not open " + filename);
+    for(auto &buffer : m_buffers) buffer.columns.Reserve(m_block_size);
+
+    m_output.write(magic, sizeof(magic) - 1);
+    WriteUInt64(m_output, version);
+    VertexColumns schema;
+    uint64_t ncolumns = 0;
+    ForEachColumn(schema, [&](const char*, const auto&) { ++ncolumns; });
+    WriteUInt64(m_output, ncolumns);
+    ForEachColumn(schema, [&](const char *name, const auto &column) {
+        WriteString(m_output, name);
+        WriteString(m_output, DType<typename std::decay_t<decltype(column)>::value_type>());
+    });
+}
+
+NuGeom::VertexWriter::~VertexWriter() {
+    try {
+        Close();
+    } catch(const std::exception &error) {
+        spdlog::error("{}", error.what());
+    }
+}
+
+void NuGeom::VertexWriter::Write(size_t thread, const InteractionVertices &vertices, uint64_t first_event) {
+    auto &buffer = Buffer(thread);
+    const auto &table = MaterialTable::Global();
+    for(size_t i = 0; i < vertices.Size(); ++i) {
+        if(vertices.weights[i] == 0) continue;
+        const auto &elements = table.Get(vertices.materials[i]).Elements();
+        const auto target = std::find_if(elements.begin(), elements.end(),
+                                         [&](const Element &elm) { return elm.Id() == vertices.elements[i]; });
+        if(target == elements.end())
+            throw std::runtime_error("VertexWriter: Element " + std::to_string(vertices.elements[i])
+                                     + " is not part of material " + std::to_string(vertices.materials[i]));
+        buffer.Add(vertices.positions[i], vertices.materials[i], static_cast<uint32_t>(target -> Z()),
+                   static_cast<uint32_t>(target -> A()), vertices.weights[i], first_event + i);
+        if(buffer.Size() >= m_block_size) WriteBlock(buffer);
+    }
+}
+
+void NuGeom::VertexWriter::WriteBlock(VertexColumns &buffer) {
+    if(buffer.Size() == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_output.is_open()) throw std::runtime_error("VertexWriter: " + m_filename + " is already closed");
+        WriteUInt64(m_output, buffer.Size());
+        ForEachColumn(buffer, [&](const char*, const auto &column) {
+            m_output.write(reinterpret_cast<const char*>(column.data()),
+                           static_cast<std::streamsize>(column.size()*sizeof(column[0])));
+        });
+        if(!m_output) throw std::runtime_error("VertexWriter: Could not write to " + m_filename);
+    }
+    m_rows += buffer.Size();
+    buffer.Clear();
+}
+
+void NuGeom::VertexWriter::Close() {
+    if(!m_output.is_open()) return;
+    for(auto &buffer : m_buffers) WriteBlock(buffer.columns);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_output.close();
+    if(!m_output) throw std::runtime_error("VertexWriter: Could not write to " + m_filename);
+}
+
+NuGeom::VertexColumns NuGeom::VertexWriter::Read(const std::string &filename) {
+    std::ifstream input(filename, std::ios::binary);
+    if(!input) throw std::runtime_error("VertexWriter: Could not open " + filename);
+    char header[sizeof(magic) - 1];
+    input.read(header, sizeof(header));
+    if(!input || std::memcmp(header, magic, sizeof(header)) != 0)
+        throw std::runtime_error("VertexWriter: " + filename + " is not a vertex file");
+    if(const auto file_version = ReadUInt64(input); file_version != version)
+        throw std::runtime_error("VertexWriter: Unsupported version " + std::to_string(file_version));
+
+    VertexColumns result;
+    uint64_t ncolumns = 0;
+    ForEachColumn(result, [&](const char*, const auto&) { ++ncolumns; });
+    if(ReadUInt64(input) != ncolumns)
+        throw std::runtime_error("VertexWriter: The columns of " + filename + " do not match");
+    ForEachColumn(result, [&](const char *name, const auto &column) {
+        const auto file_name = ReadString(input);
+        const auto file_type = ReadString(input);
+        if(file_name != name || file_type != DType<typename std::decay_t<decltype(column)>::value_type>())
+            throw std::runtime_error("VertexWriter: Expected column " + std::string(name) + " but found "
+                                     + file_name + " (" + file_type + ")");
+    });
+
+    // Blocks until the end of the file
+    while(input.peek() != std::ifstream::traits_type::eof()) {
+        const size_t nrows = ReadUInt64(input);
+        ForEachColumn(result, [&](const char*, auto &column) {
+            const size_t offset = column.size();
+            column.resize(offset + nrows);
+            input.read(reinterpret_cast<char*>(column.data() + offset),
+                       static_cast<std::streamsize>(nrows*sizeof(column[0])));
+        });
+        if(!input) throw std::runtime_error("VertexWriter: " + filename + " ends in a partial block");
+    }
+    return result;
+}
@@ -3,14 +3,19 @@
 #include "geom/LineSegment.hh"
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <atomic>
 #include <limits>
+#include <type_traits>
 #include <numeric>
 
 using NuGeom::LogicalVolume;
 using NuGeom::PhysicalVolume;
 
 double LogicalVolume::Mass() const {
-    return Volume() * m_material.Density()
+    return Volume() * GetMaterial().Density()
         + DaughterMass();
 }
 
@@ -55,6 +60,7 @@ bool LogicalVolume::SphereTrace(const Ray &ray, double &time, size_t &step, size
 }
 
 bool LogicalVolume::RayTrace(const Ray &ray, double &time, std::shared_ptr<PhysicalVolume> &vol) const {
+    if constexpr(std::is_same_v<NavigationScalar, float>) return RayTraceSingle(ray, time, vol);
     time = std::numeric_limits<double>::infinity();
     for(const auto &daughter : Daughters()) {
         double ctime = daughter -> Intersect(ray);
@@ -66,75 +72,276 @@ bool LogicalVolume::RayTrace(const Ray &ray, double &time, std::shared_ptr<Physi
     return time < std::numeric_limits<double>::infinity();
 }
 
+bool LogicalVolume::RayTraceSingle(const Ray &ray, double &time, std::shared_ptr<PhysicalVolume> &vol) const {
+    time = std::numeric_limits<double>::infinity();
+    float candidate = std::numeric_limits<float>::infinity();
+    for(const auto &daughter : Daughters()) {
+        // The single precision time only has to be good enough to reject daughters,
+        // hits within the tolerance of the current best are recomputed in double precision
+        float ctime_single = daughter -> IntersectSingle(ray);
+        if(ctime_single == std::numeric_limits<float>::infinity()
+           || ctime_single > candidate + m_single_tolerance*(1 + std::abs(candidate))) continue;
+        double ctime = daughter -> Intersect(ray);
+        if(ctime < time) {
+            time = ctime;
+            vol = daughter;
+        }
+        candidate = std::min(candidate, ctime_single);
+    }
+    return time < std::numeric_limits<double>::infinity();
+}
+
+void LogicalVolume::RayTrace(const RayBatch &batch, std::vector<double> &times,
+                             std::vector<std::shared_ptr<PhysicalVolume>> &vols) const {
+    times.assign(batch.Size(), std::numeric_limits<double>::infinity());
+    vols.assign(batch.Size(), nullptr);
+    std::vector<double> ctimes;
+    for(const auto &daughter : Daughters()) {
+        daughter -> Intersect(batch, ctimes);
+        for(size_t i = 0; i < batch.Size(); ++i) {
+            if(ctimes[i] < times[i]) {
+                times[i] = ctimes[i];
+                vols[i] = daughter;
+            }
+        }
+    }
+}
+
 void LogicalVolume::GetLineSegments(const Ray &ray, std::vector<LineSegment> &segments) const {
+    std::vector<SegmentRecord> records;
+    GetSegments(ray, records);
+    segments.reserve(segments.size() + records.size());
+    for(const auto &record : records) {
+        segments.emplace_back(ray.Propagate(record.t_start), ray.Propagate(record.t_end), record.material);
+    }
+}
+
+void LogicalVolume::GetSegments(const Ray &ray, std::vector<SegmentRecord> &segments, double start) const {
+    auto append = [&segments](const SegmentRecord &segment) { segments.push_back(segment); };
+    VisitSegments(ray, append, start);
+}
+
+void LogicalVolume::ColumnDensity(const Ray &ray, std::vector<double> &column) const {
+    const auto &table = MaterialTable::Global();
+    if(column.size() < table.Size()) column.resize(table.Size(), 0);
+    auto accumulate = [&](const SegmentRecord &segment) {
+        column[segment.material] += segment.Length()*table.Get(segment.material).Density();
+    };
+    VisitSegments(ray, accumulate, 0);
+}
+
+template<typename Visitor>
+void LogicalVolume::VisitSegments(const Ray &ray, Visitor &visit, double start) const {
     static constexpr double eps = 1e-8;
     double time = 0;
-    auto shift_ray = Ray(ray.Propagate(eps), ray.Direction());
+    auto shift_ray = Ray(ray.Propagate(eps), ray.Direction(), false);
     std::shared_ptr<PhysicalVolume> pvol = nullptr;
     if(!RayTrace(shift_ray, time, pvol)) {
         auto tmp_origin = ray.Propagate(eps);
-        auto tmp_ray = Ray(tmp_origin, ray.Direction());
-        time = m_shape -> Intersect(tmp_ray) + eps;
+        auto tmp_ray = Ray(tmp_origin, ray.Direction(), false);
+        time = m_kernel.Intersect(tmp_ray) + eps;
     }
     time += eps;
-    segments.emplace_back(ray.Origin(), ray.Propagate(time), m_material);
+    visit(SegmentRecord{start, start + time, m_material, m_id});
 
     if(!pvol) return;
     auto origin = ray.Propagate(time);
-    auto new_ray = Ray(origin, ray.Direction());
-    pvol -> GetLineSegments(new_ray, segments, {});
+    auto new_ray = Ray(origin, ray.Direction(), false);
+    pvol -> VisitSegments(new_ray, visit, {}, start + time);
+}
+
+void LogicalVolume::GetSegments(const RayBatch &batch, std::vector<SegmentRecord> &segments,
+                                std::vector<size_t> &offsets) const {
+    static constexpr double eps = 1e-8;
+    // Position of a ray in the traversal, either in a placement reached through the chain
+    // or in a logical volume without one (the world, or the mother a shared volume leaves into)
+    struct Tracker {
+        size_t ray;
+        const LogicalVolume *logical;
+        const PhysicalVolume *physical;
+        PhysicalVolume::Chain chain;
+        Vector3D origin;
+        double start;
+
+        const void* Volume() const {
+            return physical ? static_cast<const void*>(physical) : static_cast<const void*>(logical);
+        }
+    };
+
+    std::vector<Tracker> active, next;
+    active.reserve(batch.Size());
+    for(size_t i = 0; i < batch.Size(); ++i) active.push_back({i, this, nullptr, {}, batch.Origin(i), 0});
+
+    // Each step adds one segment per active ray, so the segments of a ray come out in order
+    std::vector<std::pair<size_t, SegmentRecord>> records;
+    RayBatch local, missed;
+    std::vector<double> lengths, times, exits;
+    std::vector<std::shared_ptr<PhysicalVolume>> vols;
+    std::vector<size_t> misses;
+    while(!active.empty()) {
+        std::sort(active.begin(), active.end(), [](const Tracker &a, const Tracker &b) {
+            return std::less<const void*>()(a.Volume(), b.Volume());
+        });
+        next.clear();
+        for(size_t first = 0, last = 0; first < active.size(); first = last) {
+            while(last < active.size() && active[last].Volume() == active[first].Volume()) ++last;
+            const PhysicalVolume *physical = active[first].physical;
+            const LogicalVolume &volume = physical ? *physical -> m_volume : *active[first].logical;
+
+            // Rays of the group in the frame of the volume, shifted off the surface they start on
+            local.Clear();
+            lengths.assign(last - first, 1);
+            for(size_t i = first; i < last; ++i) {
+                Ray ray(active[i].origin, batch.Direction(active[i].ray), false);
+                if(physical) {
+                    double chain_length{}, length{};
+                    ray = physical -> TransformRay(active[i].chain.Apply(ray, chain_length), length);
+                    lengths[i - first] = chain_length*length;
+                }
+                local.Add(Ray(ray.Propagate(eps), ray.Direction(), false));
+            }
+            volume.RayTrace(local, times, vols);
+
+            // Rays missing all daughters leave through the shape of the volume
+            misses.clear();
+            missed.Clear();
+            for(size_t i = 0; i < local.Size(); ++i) {
+                if(vols[i]) continue;
+                misses.push_back(i);
+                missed.Add(local.Get(i));
+            }
+            volume.GetKernel().Intersect(missed, exits);
+            for(size_t i = 0; i < misses.size(); ++i) {
+                double time = exits[i];
+                if(physical) {
+                    // A ray grazing the surface finds no exit, it leaves the volume right away
+                    if(!std::isfinite(time)) time = 0;
+                    vols[misses[i]] = physical -> m_mother;
+                } else {
+                    time += eps;
+                }
+                times[misses[i]] = time;
+            }
+
+            for(size_t i = first; i < last; ++i) {
+                const auto &tracker = active[i];
+                const auto &pvol = vols[i - first];
+                const auto direction = batch.Direction(tracker.ray);
+                // Back from the local frame to times along the global ray
+                const double time = (times[i - first] + eps)/lengths[i - first];
+                records.push_back({tracker.ray, SegmentRecord{tracker.start, tracker.start + time,
+                                                              volume.m_material, volume.m_id}});
+                Tracker moved{tracker.ray, nullptr, nullptr, {}, tracker.origin + time*direction,
+                              tracker.start + time};
+                if(!physical) {
+                    if(!pvol) continue;
+                    moved.physical = pvol.get();
+                } else if(!pvol) {
+                    auto mother = physical -> LogicalMother();
+                    if(!mother) continue;
+                    moved.logical = mother.get();
+                } else {
+                    moved.physical = pvol.get();
+                    moved.chain = pvol == physical -> m_mother ? pvol -> Leave(tracker.chain)
+                                                               : physical -> Enter(tracker.chain);
+                }
+                next.push_back(moved);
+            }
+        }
+        std::swap(active, next);
+    }
+
+    offsets.assign(batch.Size() + 1, 0);
+    for(const auto &record : records) ++offsets[record.first + 1];
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    segments.resize(records.size());
+    std::vector<size_t> filled(offsets.begin(), offsets.end() - 1);
+    for(const auto &record : records) segments[filled[record.first]++] = record.second;
+}
+
+void LogicalVolume::AddDaughter(std::shared_ptr<PhysicalVolume> daughter) {
+    daughter -> m_placed_in = weak_from_this();
+    m_daughters.push_back(std::move(daughter));
+}
+
+uint32_t LogicalVolume::NextId() {
+    static std::atomic<uint32_t> next_id{0};
+    return next_id++;
 }
 
 double PhysicalVolume::Intersect(const Ray &in_ray) const {
-    auto ray = TransformRay(in_ray);
-    return m_volume -> GetShape() -> Intersect(ray);
+    double length{};
+    auto ray = TransformRay(in_ray, length);
+    return m_volume -> GetKernel().Intersect(ray)/length;
+}
+
+void PhysicalVolume::Intersect(const RayBatch &batch, std::vector<double> &times) const {
+    if(m_transform.IsIdentity()) return m_volume -> GetKernel().Intersect(batch, times);
+
+    RayBatch local;
+    local.Reserve(batch.Size());
+    std::vector<double> lengths(batch.Size());
+    for(size_t i = 0; i < batch.Size(); ++i) local.Add(TransformRay(batch.Get(i), lengths[i]));
+    m_volume -> GetKernel().Intersect(local, times);
+    if(m_rigid) return;
+    for(size_t i = 0; i < batch.Size(); ++i) times[i] /= lengths[i];
+}
+
+float PhysicalVolume::IntersectSingle(const Ray &in_ray) const {
+    double length{};
+    auto ray = TransformRay(in_ray, length);
+    return m_volume -> GetKernelSingle().Intersect(RayF(ray))/static_cast<float>(length);
 }
 
 void PhysicalVolume::GetLineSegments(const Ray &in_ray, std::vector<LineSegment> &segments,
-                                     const Transform3D &from_global) const {
+                                     const RigidTransform3D &from_global) const {
+    std::vector<SegmentRecord> records;
+    GetSegments(in_ray, records, from_global, 0);
+    segments.reserve(segments.size() + records.size());
+    for(const auto &record : records) {
+        segments.emplace_back(in_ray.Propagate(record.t_start), in_ray.Propagate(record.t_end), record.material);
+    }
+}
+
+void PhysicalVolume::GetSegments(const Ray &in_ray, std::vector<SegmentRecord> &segments,
+                                 const RigidTransform3D &from_global, double start) const {
+    auto append = [&segments](const SegmentRecord &segment) { segments.push_back(segment); };
+    VisitSegments(in_ray, append, Chain{from_global}, start);
+}
+
+template<typename Visitor>
+void PhysicalVolume::VisitSegments(const Ray &in_ray, Visitor &visit,
+                                   const Chain &from_global, double start) const {
     static constexpr double eps = 1e-8;
-    auto local_ray = Transform3D::ApplyRay(in_ray, from_global);
-    auto ray = TransformRay(local_ray);
-    auto shift_ray = Ray(ray.Propagate(eps), ray.Direction());
+    double chain_length{}, length{};
+    auto local_ray = from_global.Apply(in_ray, chain_length);
+    auto ray = TransformRay(local_ray, length);
+    auto shift_ray = Ray(ray.Propagate(eps), ray.Direction(), false);
     double time = 0;
     std::shared_ptr<PhysicalVolume> pvol = nullptr;
     if(!RayTrace(shift_ray, time, pvol)) {
         auto tmp_origin = ray.Propagate(eps);
-        auto tmp_ray = Ray(tmp_origin, ray.Direction());
-        time = m_volume -> GetShape() -> Intersect(tmp_ray);
+        auto tmp_ray = Ray(tmp_origin, ray.Direction(), false);
+        time = m_volume -> GetKernel().Intersect(tmp_ray);
+        // A ray grazing the surface finds no exit, it leaves the volume right away
+        if(!std::isfinite(time)) time = 0;
 
         if(m_mother) {
             pvol = m_mother;
         }
     }
-    time += eps;
-    auto origin = in_ray.Propagate(time);
-    segments.emplace_back(in_ray.Origin(), origin, m_volume -> GetMaterial());
-    auto new_ray = Ray(origin, in_ray.Direction());
+    // Back from the local frame to times along the global ray
+    time = (time + eps)/(chain_length*length);
+    visit(SegmentRecord{start, start + time, m_volume -> GetMaterialId(), m_volume -> GetId()});
+    auto new_ray = Ray(in_ray.Propagate(time), in_ray.Direction(), false);
 
     if(!pvol) {
-        if(m_volume -> Mother()) {
-            m_volume -> Mother() -> GetLineSegments(new_ray, segments); 
+        if(auto mother = LogicalMother()) {
+            mother -> VisitSegments(new_ray, visit, start + time);
         }
         return;
     }
-    Transform3D transform = m_transform;
-    if(pvol == m_mother) {
-        transform = pvol -> GetTransform().Inverse();
-    }
-    auto newtransform = from_global*transform;
-    pvol -> GetLineSegments(new_ray, segments, newtransform);
-}
-
-NuGeom::Ray PhysicalVolume::TransformRay(const Ray &ray) const {
-    if(is_identity) return ray;
-    else if(is_translation) return Transform3D::TranslateRay(ray, m_trans);
-    return Transform3D::ApplyRay(ray, m_trans, m_rot);
+    // Transform from the global frame into the frame the next volume is placed in
+    const Chain newtransform = pvol == m_mother ? pvol -> Leave(from_global) : Enter(from_global);
+    pvol -> VisitSegments(new_ray, visit, newtransform, start + time);
 }
-
-NuGeom::Ray PhysicalVolume::TransformRayInverse(const Ray &ray) const {
-    if(is_identity) return ray;
-    else if(is_translation) return Transform3D::TranslateRay(ray, m_trans);
-    return Transform3D::ApplyRay(ray, m_transform.Inverse());
-}
-
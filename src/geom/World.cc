@@ -1,9 +1,12 @@
 #include "geom/World.hh"
 #include "geom/Ray.hh"
 #include "geom/LineSegment.hh"
+#include "geom/Utilities.hh"
+#include <algorithm>
 #include <limits>
 #include <iostream>
 #include <deque>
+#include <unordered_map>
 
 using NuGeom::World;
 
@@ -22,7 +25,7 @@ NuGeom::Material World::GetMaterial(size_t idx) const {
 }
 
 bool World::InWorld(const Vector3D &pos) const {
-    return m_volume -> GetShape() -> SignedDistance(pos) <= 0;
+    return m_volume -> GetKernel().SignedDistance(pos) <= 0;
 }
 
 bool World::SphereTrace(const Ray &ray, double &distance, size_t &step, size_t &idx) const {
@@ -42,16 +45,23 @@ bool World::SphereTrace(const Ray &ray, double &distance, size_t &step, size_t &
 }
 
 bool World::RayTrace(const Ray &ray, double &distance, size_t &idx) const {
-    double tmin = std::numeric_limits<double>::infinity();
-    for(size_t i = 0; i < m_volume -> Daughters().size(); ++i) {
-        double time = m_volume -> Daughters()[i] -> Intersect(ray);
-        if(time < tmin) {
-            tmin = time;
-            idx = i+1;
-        }
+    std::shared_ptr<PhysicalVolume> pvol = nullptr;
+    if(!m_volume -> RayTrace(ray, distance, pvol)) return false;
+    const auto &daughters = m_volume -> Daughters();
+    idx = static_cast<size_t>(std::distance(daughters.begin(), std::find(daughters.begin(), daughters.end(), pvol))) + 1;
+    return true;
+}
+
+void World::RayTrace(const RayBatch &batch, std::vector<double> &distances, std::vector<size_t> &idxs) const {
+    std::vector<std::shared_ptr<PhysicalVolume>> pvols;
+    m_volume -> RayTrace(batch, distances, pvols);
+    const auto &daughters = m_volume -> Daughters();
+    std::unordered_map<const PhysicalVolume*, size_t> daughter_idx;
+    for(size_t i = 0; i < daughters.size(); ++i) daughter_idx.emplace(daughters[i].get(), i+1);
+    idxs.assign(batch.Size(), 0);
+    for(size_t i = 0; i < batch.Size(); ++i) {
+        if(pvols[i]) idxs[i] = daughter_idx[pvols[i].get()];
     }
-    distance = tmin;
-    return tmin < std::numeric_limits<double>::infinity();
 }
 
 std::vector<NuGeom::LineSegment> World::GetLineSegments(const Ray &ray) const {
@@ -60,6 +70,77 @@ std::vector<NuGeom::LineSegment> World::GetLineSegments(const Ray &ray) const {
     return segments;
 }
 
+std::vector<std::vector<NuGeom::LineSegment>> World::GetLineSegments(const RayBatch &batch) const {
+    std::vector<SegmentRecord> records;
+    std::vector<size_t> offsets;
+    m_volume -> GetSegments(batch, records, offsets);
+    std::vector<std::vector<NuGeom::LineSegment>> segments(batch.Size());
+    for(size_t i = 0; i < batch.Size(); ++i) {
+        const auto ray = batch.Get(i);
+        segments[i].reserve(offsets[i+1] - offsets[i]);
+        for(size_t j = offsets[i]; j < offsets[i+1]; ++j) {
+            segments[i].emplace_back(ray.Propagate(records[j].t_start), ray.Propagate(records[j].t_end),
+                                     records[j].material);
+        }
+    }
+    return segments;
+}
+
+void World::GetLineSegments(const Ray &ray, std::vector<SegmentRecord> &segments) const {
+    m_volume -> GetSegments(ray, segments);
+}
+
+void World::GetLineSegments(const RayBatch &batch, std::vector<SegmentRecord> &segments,
+                            std::vector<size_t> &offsets) const {
+    m_volume -> GetSegments(batch, segments, offsets);
+}
+
+void World::ColumnDensity(const Ray &ray, std::vector<double> &per_material,
+                          std::vector<double> *per_element) const {
+    std::fill(per_material.begin(), per_material.end(), 0);
+    m_volume -> ColumnDensity(ray, per_material);
+    if(!per_element) return;
+
+    std::fill(per_element -> begin(), per_element -> end(), 0);
+    const auto &table = MaterialTable::Global();
+    for(MaterialId id = 0; id < per_material.size(); ++id) {
+        if(per_material[id] == 0) continue;
+        const auto &material = table.Get(id);
+        const auto &elements = material.Elements();
+        const auto &fractions = material.MassFractions();
+        for(size_t i = 0; i < elements.size(); ++i) {
+            const auto element = elements[i].Id();
+            if(element >= per_element -> size()) per_element -> resize(element + 1, 0);
+            (*per_element)[element] += per_material[id]*fractions[i];
+        }
+    }
+}
+
+namespace {
+
+void HashVolume(NuGeom::Hasher &hasher, const NuGeom::LogicalVolume &volume) {
+    const auto &material = volume.GetMaterial();
+    hasher.Add(material.Name()).Add(material.Density());
+    for(size_t i = 0; i < material.Elements().size(); ++i) {
+        hasher.Add(material.Elements()[i].Id()).Add(material.Elements()[i].Mass());
+        if(i < material.MassFractions().size()) hasher.Add(material.MassFractions()[i]);
+    }
+    if(const auto *shape = volume.GetShape()) shape -> Hash(hasher);
+    hasher.Add(volume.Daughters().size());
+    for(const auto &daughter : volume.Daughters()) {
+        for(const auto &entry : daughter -> GetTransform().GetTransform()) hasher.Add(entry);
+        HashVolume(hasher, *daughter -> GetLogicalVolume());
+    }
+}
+
+}
+
+uint64_t World::Fingerprint() const {
+    NuGeom::Hasher hasher;
+    if(m_volume) HashVolume(hasher, *m_volume);
+    return hasher.Value();
+}
+
 std::pair<double, size_t> World::GetSDF(const Vector3D &pos) const {
     double distance = std::numeric_limits<double>::max();
     size_t idx = 0;
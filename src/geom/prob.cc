@@ -17,6 +17,8 @@
 #include "geom/Ray.hh"
 #include "geom/LineSegment.hh"
 #include "geom/Parser.hh"
+#include "geom/Random.hh"
+#include "geom/VertexWriter.hh"
 
 using NuGeom::LogicalVolume;
 using NuGeom::PhysicalVolume;
@@ -204,8 +206,9 @@ int main(){
     hist_exp2.close();
 
 
-    std::random_device rd0;
-    std::mt19937 rand_gen0(rd0());
+    // Fixed seed with one stream per study, so runs are reproducible
+    constexpr uint64_t seed = 20230101;
+    NuGeom::RandomStream rand_gen0(seed, 0);
     std::uniform_real_distribution<>dis0(0.0,1.0);
 
     size_t N0=10000;
@@ -236,17 +239,11 @@ int main(){
 
 // Sending out rays in random direction
     double N=200;
-    std::ofstream interpt;
-    std::ofstream interptXY;
-    std::ofstream interptYZ;
-    std::ofstream interptZX;
-    interpt.open("interactionpt.txt");
-    interptXY.open("XYinteraction.txt");
-    interptYZ.open("YZinteraction.txt");
-    interptZX.open("ZXinteraction.txt");
-
-    std::random_device rd;
-    std::mt19937 rand_gen(rd());
+    // Binary vertex file, the projections are made when reading it back. No target element is
+    // sampled here, so Z and A are left at 0
+    NuGeom::VertexWriter interpt("interactionpt.bin");
+
+    NuGeom::RandomStream rand_gen(seed, 1);
     std::uniform_real_distribution<>dis(0.0,1.0);
 
     // std::random_device rd2;
@@ -303,22 +300,18 @@ int main(){
 
 
         Vector3D interaction_point{};
+        NuGeom::MaterialId interaction_material{};
         for(size_t i=0; i<probs.size(); i++)
         {
             sum_prob+=probs[i];
             if(rand<sum_prob){ 
             interaction_point=segments[i].Start()+(segments[i].End()-segments[i].Start())*((rand+probs[i]-sum_prob)/(probs[i]));
+            interaction_material=segments[i].GetMaterialId();
             break;}
         }
-        interpt<< interaction_point.X() << "," << interaction_point.Y() << "," << interaction_point.Z() << "\n";
-        interptXY<< interaction_point.X() << "," << interaction_point.Y() << "\n";
-        interptYZ<< interaction_point.Y() << "," << interaction_point.Z() << "\n";
-        interptZX<< interaction_point.Z() << "," << interaction_point.X() << "\n";
+        interpt.Write(0, interaction_point, interaction_material, 0, 0, 1, static_cast<uint64_t>(n));
     }
-    interpt.close();
-    interptXY.close();
-    interptYZ.close();
-    interptZX.close();
+    interpt.Close();
 
    
     return 0;
@@ -0,0 +1,119 @@
+#include "catch2/catch.hpp"
+
+#include "geom/CrossSectionCache.hh"
+#include "geom/CrossSectionTable.hh"
+#include "geom/Material.hh"
+#include "geom/MaterialTable.hh"
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+TEST_CASE("Cross section table", "[CrossSection]") {
+    NuGeom::MaterialTable materials;
+    NuGeom::Material water("water", 1.0, 2);
+    water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    auto id = materials.Add(water);
+
+    // Power law cross section, exactly reproduced by log-log interpolation
+    size_t ncalls = 0;
+    auto calculator = [&ncalls](const NuGeom::Element &elm, double energy) {
+        ++ncalls;
+        return static_cast<double>(elm.Z())*std::pow(energy, 0.7);
+    };
+    auto grid = NuGeom::CrossSectionTable::LogSpaced(1, 1000, 31);
+    REQUIRE(grid.size() == 31);
+    CHECK(grid.front() == 1);
+    CHECK(grid.back() == 1000);
+
+    NuGeom::CrossSectionTable table(calculator, grid, materials);
+    CHECK(ncalls == grid.size()*water.NElements());
+    CHECK(table.NMaterials() == materials.Size());
+
+    auto expected = [&](double energy) {
+        return (water.MassFractions()[0]*1 + water.MassFractions()[1]*8)*std::pow(energy, 0.7);
+    };
+    for(double energy : {1.0, 2.5, 17.0, 333.3, 999.0}) {
+        CHECK(table.Total(id, energy) == Approx(expected(energy)).epsilon(1e-10));
+    }
+    // Energies outside the grid are clamped
+    CHECK(table.Total(id, 0.5) == Approx(expected(1)));
+    CHECK(table.Total(id, 5000) == Approx(expected(1000)));
+    // The empty material has no cross section
+    CHECK(table.Total(0, 10) == 0);
+    CHECK(ncalls == grid.size()*water.NElements());
+
+    std::vector<double> contributions;
+    table.Contributions(id, 42, contributions);
+    REQUIRE(contributions.size() == 2);
+    CHECK(contributions[0] + contributions[1] == Approx(table.Total(id, 42)));
+    CHECK(contributions[1]/contributions[0] == Approx(8*water.MassFractions()[1]/water.MassFractions()[0]));
+
+    const auto &sampler = table.ElementSampler(id, 42);
+    CHECK(sampler.Probability(1) == Approx(contributions[1]/table.Total(id, 42)));
+    // Sweep the random number to compare the sampled frequencies with the contributions
+    size_t noxygen = 0;
+    constexpr size_t nsamples = 10000;
+    for(size_t i = 0; i < nsamples; ++i) {
+        if(table.SampleElement(id, 42, (static_cast<double>(i) + 0.5)/nsamples) == 1) ++noxygen;
+    }
+    CHECK(static_cast<double>(noxygen)/nsamples == Approx(contributions[1]/table.Total(id, 42)).margin(1e-3));
+    CHECK_THROWS_WITH(table.SampleElement(0, 42, 0.5),
+                      "CrossSectionTable: Material 0 has no cross section at this energy");
+    CHECK_THROWS_WITH(table.ElementSampler(0, 42),
+                      "CrossSectionTable: Material 0 has no cross section at this energy");
+    CHECK_THROWS_WITH(table.Total(static_cast<NuGeom::MaterialId>(materials.Size()), 1),
+                      Catch::Contains("is not tabulated"));
+
+    CHECK_THROWS_WITH(NuGeom::CrossSectionTable(calculator, {1}, materials),
+                      "CrossSectionTable: Energy grid needs at least two points");
+    CHECK_THROWS_WITH(NuGeom::CrossSectionTable(calculator, {1, 3, 2}, materials),
+                      "CrossSectionTable: Energy grid must be positive and increasing");
+}
+
+TEST_CASE("Cross section cache", "[CrossSection]") {
+    std::atomic<size_t> ncalls{0};
+    auto calculator = [&ncalls](const NuGeom::Element &elm, double energy) {
+        ++ncalls;
+        return static_cast<double>(elm.A())*energy;
+    };
+    CHECK_THROWS_WITH(NuGeom::CrossSectionCache(calculator, 0), "CrossSectionCache: Tolerance must be positive");
+
+    NuGeom::CrossSectionCache cache(calculator, 1e-3, 64);
+    NuGeom::Element carbon("Carbon", 6, 12);
+    NuGeom::Element carbon13("Carbon13", 6, 13, 13);
+
+    double value = cache(carbon, 100);
+    CHECK(value == Approx(1200).epsilon(1e-3));
+    // Energies within the tolerance share the cached value
+    CHECK(cache(carbon, 100.00001) == value);
+    CHECK(cache(carbon13, 100) == Approx(1300).epsilon(1e-3));
+    CHECK(cache(carbon, 200) == Approx(2400).epsilon(1e-3));
+    CHECK(cache.Hits() == 1);
+    CHECK(cache.Misses() == 3);
+    CHECK(ncalls == 3);
+    CHECK(cache.Size() == 3);
+
+    SECTION("Concurrent lookups") {
+        // Catch assertions are not thread safe, so only count the mismatches in the threads
+        std::atomic<size_t> nwrong{0};
+        std::vector<std::thread> threads;
+        for(size_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&]() {
+                for(size_t i = 0; i < 1000; ++i) {
+                    double energy = 1 + static_cast<double>(i % 10);
+                    if(std::abs(cache(carbon, energy) - 12*energy) > 12*energy*1e-3) ++nwrong;
+                }
+            });
+        }
+        for(auto &thread : threads) thread.join();
+        CHECK(nwrong == 0);
+        CHECK(cache.Hits() + cache.Misses() == 4 + 4000);
+        CHECK(cache.Size() <= 64);
+    }
+
+    cache.Clear();
+    CHECK(cache.Size() == 0);
+    CHECK(cache.Hits() == 0);
+}
@@ -0,0 +1,236 @@
+#include "catch2/catch.hpp"
+
+#include "geom/Interface.hh"
+#include "geom/VertexWriter.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <numeric>
+#include <thread>
+
+using NuGeom::LogicalVolume;
+using NuGeom::PhysicalVolume;
+
+TEST_CASE("Interaction vertices", "[DetectorSim]") {
+    NuGeom::Material water("Water", 1.0, 2);
+    water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    NuGeom::Material iron("Iron", 7.8, 1);
+    iron.AddElement(NuGeom::Element("Iron", 26, 56), 1);
+    auto world_box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{10, 10, 10});
+    auto world_vol = std::make_shared<LogicalVolume>(water, world_box);
+    auto box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{4, 4, 2});
+    auto box_vol = std::make_shared<LogicalVolume>(iron, box);
+    world_vol -> AddDaughter(std::make_shared<PhysicalVolume>(box_vol, NuGeom::Translation3D{0, 0, 1},
+                                                              NuGeom::Transform3D{}));
+    box_vol -> SetMother(world_vol);
+
+    // Cross section proportional to A, large enough for the iron to shadow the water behind it
+    const double scale = 0.01;
+    auto xsec = [scale](const NuGeom::Element &elm, double energy) {
+        return scale*static_cast<double>(elm.A())*energy/1000;
+    };
+    NuGeom::DetectorSim sim{NuGeom::World(world_vol)};
+    sim.SetCrossSectionCalculator(xsec);
+
+    std::vector<NuGeom::Neutrino> neutrinos;
+    for(size_t i = 0; i < 20000; ++i) {
+        double x = -1.5 + 3*static_cast<double>(i % 100)/100;
+        neutrinos.push_back({{x, 0.5, -4.9}, {0, 0, 1}, 1000});
+    }
+
+    NuGeom::InteractionVertices vertices;
+    sim.GenerateInteractions(neutrinos, 1234, vertices, 1);
+    REQUIRE(vertices.Size() == neutrinos.size());
+
+    // Optical depths through 4.9 cm of water before the iron and 3 cm after
+    const auto water_id = world_vol -> GetMaterialId();
+    const auto iron_id = box_vol -> GetMaterialId();
+    const double water_xsec = scale*(water.MassFractions()[0]*1 + water.MassFractions()[1]*16);
+    const double iron_xsec = scale*56;
+    const double depth_before = 4.9*water_xsec, depth_iron = 2*7.8*iron_xsec, depth_after = 3*water_xsec;
+    const double total_depth = depth_before + depth_iron + depth_after;
+    CHECK(vertices.weights[0] == Approx(1 - std::exp(-total_depth)).epsilon(1e-4));
+
+    size_t nwater_before = 0, niron = 0, nwater_after = 0, nhydrogen = 0, nwrong = 0;
+    for(size_t i = 0; i < vertices.Size(); ++i) {
+        const auto &pos = vertices.positions[i];
+        if(std::abs(pos.Y() - 0.5) > 1e-8) ++nwrong;
+        if(vertices.materials[i] == iron_id) {
+            ++niron;
+            if(vertices.elements[i] != iron.Elements()[0].Id() || pos.Z() < -1e-8 || pos.Z() > 2 + 1e-8) ++nwrong;
+        } else if(vertices.materials[i] == water_id) {
+            if(pos.Z() < 0) ++nwater_before;
+            else ++nwater_after;
+            if(vertices.elements[i] == water.Elements()[0].Id()) ++nhydrogen;
+        } else {
+            ++nwrong;
+        }
+    }
+    CHECK(nwrong == 0);
+    const double n = static_cast<double>(vertices.Size());
+    const double norm = 1 - std::exp(-total_depth);
+    CHECK(static_cast<double>(nwater_before)/n == Approx((1 - std::exp(-depth_before))/norm).margin(0.01));
+    CHECK(static_cast<double>(niron)/n
+          == Approx((std::exp(-depth_before) - std::exp(-depth_before - depth_iron))/norm).margin(0.01));
+    const double hydrogen_frac = water.MassFractions()[0]*1/(water_xsec/scale);
+    CHECK(static_cast<double>(nhydrogen)/static_cast<double>(nwater_before + nwater_after)
+          == Approx(hydrogen_frac).margin(0.01));
+
+    SECTION("Results do not depend on the number of threads") {
+        NuGeom::InteractionVertices parallel;
+        sim.GenerateInteractions(neutrinos, 1234, parallel, 4);
+        CHECK(parallel.positions == vertices.positions);
+        CHECK(parallel.materials == vertices.materials);
+        CHECK(parallel.elements == vertices.elements);
+        CHECK(parallel.weights == vertices.weights);
+    }
+
+    SECTION("Cached cross sections") {
+        sim.SetCachedCrossSectionCalculator(xsec, 1e-6);
+        NuGeom::InteractionVertices cached;
+        sim.GenerateInteractions(neutrinos, 1234, cached, 2);
+        CHECK(cached.weights[0] == Approx(vertices.weights[0]).epsilon(1e-5));
+        CHECK(sim.GetCrossSectionCache() -> Misses() == 3);
+        CHECK(sim.GetCrossSectionCache() -> Hits() > 0);
+    }
+
+    SECTION("Sharded flux files") {
+        std::vector<NuGeom::FluxRecord> records;
+        for(size_t i = 0; i < neutrinos.size(); ++i) {
+            const auto &nu = neutrinos[i];
+            records.push_back({{nu.position.X(), nu.position.Y(), nu.position.Z()},
+                               {nu.direction.X(), nu.direction.Y(), nu.direction.Z()},
+                               nu.energy, i % 2 ? 2.0 : 1.0, 211, 0, 10000});
+        }
+        const auto filename = (std::filesystem::temp_directory_path() / "nugeom_test_sim_flux.bin").string();
+        NuGeom::MappedFluxFile::Write(filename, records);
+        {
+            NuGeom::MappedFluxFile file(filename);
+            NuGeom::InteractionVertices batch_vertices;
+            size_t nmismatch = 0, nrecords = 0;
+            for(size_t shard = 0; shard < 3; ++shard) {
+                auto stream = file.Shard(shard, 3);
+                for(auto batch = stream.Next(1000); !batch.Empty(); batch = stream.Next(1000)) {
+                    sim.GenerateInteractions(batch, 1234, batch_vertices, 2);
+                    for(size_t i = 0; i < batch.size; ++i) {
+                        const size_t idx = batch.first + i;
+                        if(batch_vertices.positions[i] != vertices.positions[idx]
+                           || batch_vertices.elements[i] != vertices.elements[idx]
+                           || batch_vertices.weights[i] != vertices.weights[idx]*records[idx].weight) ++nmismatch;
+                    }
+                    nrecords += batch.size;
+                }
+            }
+            CHECK(nrecords == records.size());
+            CHECK(nmismatch == 0);
+        }
+        std::filesystem::remove(filename);
+    }
+
+    SECTION("Single interactions") {
+        sim.SetSeed(1234);
+        auto [pos, elm] = sim.GetInteraction(neutrinos[0].position, neutrinos[0].direction, 1000);
+        CHECK(pos == vertices.positions[0]);
+        CHECK(elm.Id() == vertices.elements[0]);
+    }
+}
+
+TEST_CASE("Materials added after the cross sections", "[DetectorSim]") {
+    NuGeom::Material water("Water", 1.0, 2);
+    water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    auto world_vol = std::make_shared<LogicalVolume>(water, std::make_shared<NuGeom::Box>(NuGeom::Vector3D{10, 10, 10}));
+    NuGeom::DetectorSim sim{NuGeom::World(world_vol)};
+    sim.SetCrossSectionCalculator([](const NuGeom::Element &elm, double energy) {
+        return 0.01*static_cast<double>(elm.A())*energy/1000;
+    });
+
+    // The tungsten is not in the material table yet when the cross sections are tabulated
+    NuGeom::Material tungsten("Tungsten", 19.3, 1);
+    tungsten.AddElement(NuGeom::Element("W"), 1);
+    auto box_vol = std::make_shared<LogicalVolume>(tungsten, std::make_shared<NuGeom::Box>(NuGeom::Vector3D{4, 4, 2}));
+    world_vol -> AddDaughter(std::make_shared<PhysicalVolume>(box_vol, NuGeom::Translation3D{0, 0, 1},
+                                                              NuGeom::Transform3D{}));
+    box_vol -> SetMother(world_vol);
+
+    std::vector<NuGeom::Neutrino> neutrinos(1000, {{0, 0.5, -4.9}, {0, 0, 1}, 1000});
+    NuGeom::InteractionVertices vertices;
+    REQUIRE_NOTHROW(sim.GenerateInteractions(neutrinos, 1234, vertices, 2));
+    const auto ntungsten = std::count(vertices.materials.begin(), vertices.materials.end(),
+                                      box_vol -> GetMaterialId());
+    CHECK(ntungsten > 0);
+    for(size_t i = 0; i < vertices.Size(); ++i) {
+        if(vertices.materials[i] == box_vol -> GetMaterialId())
+            CHECK(vertices.elements[i] == tungsten.Elements()[0].Id());
+    }
+    CHECK_NOTHROW(sim.GetInteraction({0, 0.5, -4.9}, {0, 0, 1}, 1000));
+}
+
+TEST_CASE("Vertex files", "[DetectorSim]") {
+    const auto filename = (std::filesystem::temp_directory_path() / "nugeom_test_vertices.bin").string();
+    constexpr size_t nthreads = 4, nper_thread = 2500;
+    {
+        NuGeom::VertexWriter writer(filename, nthreads, 1000);
+        std::vector<std::thread> threads;
+        for(size_t thread = 0; thread < nthreads; ++thread) {
+            threads.emplace_back([&writer, thread] {
+                for(size_t i = 0; i < nper_thread; ++i) {
+                    const size_t event = thread*nper_thread + i;
+                    const double x = static_cast<double>(event);
+                    writer.Write(thread, {x, -x, 0.5*x}, 1, 18, 40, 1/(x + 1), event);
+                }
+            });
+        }
+        for(auto &thread : threads) thread.join();
+        // Full blocks are written as soon as they fill up
+        CHECK(writer.Rows() == 8000);
+        CHECK_THROWS_WITH(writer.Write(nthreads, {}, 0, 0, 0, 0, 0),
+                          "VertexWriter: Thread index 4 out of range for 4 threads");
+    }
+
+    auto columns = NuGeom::VertexWriter::Read(filename);
+    REQUIRE(columns.Size() == nthreads*nper_thread);
+    // Blocks of the threads are interleaved, the event column identifies the rows
+    std::vector<size_t> order(columns.Size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t i, size_t j) { return columns.event[i] < columns.event[j]; });
+    size_t nwrong = 0;
+    for(size_t event = 0; event < order.size(); ++event) {
+        const size_t i = order[event];
+        const double x = static_cast<double>(event);
+        if(columns.event[i] != event || columns.x[i] != x || columns.y[i] != -x || columns.z[i] != 0.5*x
+           || columns.material[i] != 1 || columns.Z[i] != 18 || columns.A[i] != 40 || columns.weight[i] != 1/(x + 1))
+            ++nwrong;
+    }
+    CHECK(nwrong == 0);
+
+    SECTION("Generated vertices") {
+        NuGeom::Material argon("Argon", 1.4, 1);
+        argon.AddElement(NuGeom::Element("Argon", 18, 40), 1);
+        const auto argon_id = NuGeom::MaterialTable::Global().Add(argon);
+        NuGeom::InteractionVertices vertices;
+        vertices.Resize(3);
+        vertices.positions = {{1, 2, 3}, {0, 0, 0}, {4, 5, 6}};
+        vertices.materials = {argon_id, 0, argon_id};
+        vertices.elements = {argon.Elements()[0].Id(), 0, argon.Elements()[0].Id()};
+        vertices.weights = {0.25, 0, 0.5};
+        {
+            NuGeom::VertexWriter writer(filename);
+            writer.Write(0, vertices, 100);
+            writer.Close();
+            CHECK(writer.Rows() == 2);
+        }
+        auto generated = NuGeom::VertexWriter::Read(filename);
+        CHECK(generated.event == std::vector<uint64_t>{100, 102});
+        CHECK(generated.z == std::vector<double>{3, 6});
+        CHECK(generated.Z == std::vector<uint32_t>{18, 18});
+        CHECK(generated.A == std::vector<uint32_t>{40, 40});
+        CHECK(generated.weight == std::vector<double>{0.25, 0.5});
+    }
+
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 4);
+    CHECK_THROWS_WITH(NuGeom::VertexWriter::Read(filename), Catch::EndsWith("ends in a partial block"));
+    std::filesystem::remove(filename);
+}
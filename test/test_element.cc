@@ -19,3 +19,63 @@ TEST_CASE("Elements", "[Materials]") {
         CHECK(hydrogen.Symbol() == hydrogen3.Symbol());
     }
 }
+
+TEST_CASE("Periodic table", "[Materials]") {
+    static_assert(NuGeom::PeriodicTable::Find("Fe") == 26);
+    static_assert(NuGeom::PeriodicTable::Find("Oganesson") == 118);
+    static_assert(NuGeom::PeriodicTable::Find("Unobtainium") == 0);
+    static_assert(NuGeom::PeriodicTable::Get(8).symbol == "O");
+
+    SECTION("Natural elements") {
+        NuGeom::Element iron(26);
+        CHECK(iron.Symbol() == "Fe");
+        CHECK(iron.Name() == "Iron");
+        CHECK(iron.Id() == 26);
+        CHECK(iron.A() == 56);
+        CHECK(iron.Mass() == Approx(55.845));
+        CHECK(NuGeom::Element("Lead").Id() == 82);
+        CHECK(NuGeom::Element("W").Z() == 74);
+        // Copper (63.546) rounds up, so looking it up by name or by Z has to agree on A
+        CHECK(NuGeom::Element("Copper").A() == NuGeom::Element(NuGeom::ElementId{29}).A());
+        CHECK(NuGeom::Element("Copper").A() == 64);
+        CHECK_THROWS_WITH(NuGeom::Element(NuGeom::ElementId{119}), "PeriodicTable: Invalid atomic number 119");
+        CHECK_THROWS_WITH(NuGeom::Element("Unobtainium"), "Invalid element Unobtainium");
+    }
+
+    SECTION("Lookup by symbol and name") {
+        for(NuGeom::ElementId Z = 1; Z <= NuGeom::PeriodicTable::MaxZ; ++Z) {
+            CHECK(NuGeom::PeriodicTable::Find(NuGeom::PeriodicTable::Get(Z).symbol) == Z);
+            CHECK(NuGeom::PeriodicTable::Find(NuGeom::PeriodicTable::Get(Z).name) == Z);
+        }
+        CHECK(NuGeom::PeriodicTable::Find("") == 0);
+        CHECK(NuGeom::PeriodicTable::Find("Zz") == 0);
+    }
+
+    SECTION("User defined masses") {
+        // Atomic weights as rounded in common GDML files are the natural element
+        NuGeom::Element oxygen("oxygen", 8, 15.9994);
+        CHECK(oxygen.Id() == 8);
+        CHECK(oxygen == NuGeom::Element(8));
+        // Any other mass is registered as an isotope
+        NuGeom::Element heavy_hydrogen("HeavyHydrogen", 1, 2.014);
+        CHECK(heavy_hydrogen.Id() >= NuGeom::IsotopeRegistry::FirstId);
+        CHECK(heavy_hydrogen.A() == 2);
+        CHECK(heavy_hydrogen != NuGeom::Element(1));
+        CHECK(heavy_hydrogen == NuGeom::Element("HeavyHydrogen2", 1, 2.014));
+        CHECK(heavy_hydrogen != NuGeom::Element("HeavyHydrogen3", 1, 2.0));
+    }
+
+    SECTION("Isotopes") {
+        auto &registry = NuGeom::IsotopeRegistry::Global();
+        NuGeom::Element deuterium("Deuterium", "D", 1, 2.014, 2);
+        NuGeom::Element deuterium2("Deuterium2", 1, 2.014, 2);
+        NuGeom::Element tritium("Tritium", "T", 1, 3.016, 3);
+        CHECK(deuterium.Id() >= NuGeom::IsotopeRegistry::FirstId);
+        CHECK(deuterium.Id() == deuterium2.Id());
+        CHECK(deuterium.Id() != tritium.Id());
+        CHECK(deuterium != NuGeom::Element(1));
+        CHECK(registry.Get(tritium.Id()).A == 3);
+        CHECK(registry.Get(tritium.Id()).Z == 1);
+        CHECK_THROWS_WITH(registry.Get(1), "IsotopeRegistry: Undefined isotope id 1");
+    }
+}
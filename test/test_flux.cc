@@ -0,0 +1,263 @@
+#include "catch2/catch.hpp"
+
+#include "geom/DensityMap.hh"
+#include "geom/Flux.hh"
+#include "geom/FluxSampler.hh"
+#include "geom/FluxWindow.hh"
+#include "geom/MaxPathLength.hh"
+#include "geom/Volume.hh"
+#include "geom/World.hh"
+
+#include <filesystem>
+#include <fstream>
+
+using NuGeom::LogicalVolume;
+using NuGeom::PhysicalVolume;
+
+namespace {
+
+/// Water filled world with a sphere of iron at the origin and an iron slab behind it
+struct FluxGeometry {
+    FluxGeometry() {
+        water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+        water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+        iron.AddElement(NuGeom::Element("Iron", 26, 56), 1);
+        auto world_vol = std::make_shared<LogicalVolume>(water, std::make_shared<NuGeom::Box>(NuGeom::Vector3D{20, 20, 20}));
+        sphere = std::make_shared<LogicalVolume>(iron, std::make_shared<NuGeom::Sphere>(2));
+        world_vol -> AddDaughter(std::make_shared<PhysicalVolume>(sphere, NuGeom::Transform3D{}, NuGeom::Transform3D{}));
+        sphere -> SetMother(world_vol);
+        world = NuGeom::World(world_vol);
+        water_id = world_vol -> GetMaterialId();
+        iron_id = sphere -> GetMaterialId();
+    }
+
+    NuGeom::Material water{"Water", 1.0, 2}, iron{"Iron", 7.8, 1};
+    std::shared_ptr<LogicalVolume> sphere;
+    NuGeom::World world;
+    NuGeom::MaterialId water_id{}, iron_id{};
+};
+
+}
+
+TEST_CASE("Flux window", "[Flux]") {
+    NuGeom::FluxWindow window({-1, -1, -5}, {2, 0, 0}, {0, 2, 0}, {0, 0, 3});
+    CHECK(window.Area() == Approx(4));
+    CHECK(window.Direction() == NuGeom::Vector3D{0, 0, 1});
+    CHECK(window.Point(0.5, 0.5) == NuGeom::Vector3D{0, 0, -5});
+    CHECK(window.GetRay(0, 1).Origin() == NuGeom::Vector3D{-1, 1, -5});
+
+    auto point_source = NuGeom::FluxWindow::FromPointSource({-1, -1, -5}, {2, 0, 0}, {0, 2, 0}, {0, 0, -10});
+    CHECK(point_source.Direction() == NuGeom::Vector3D{0, 0, 1});
+    auto ray = point_source.GetRay(1, 1);
+    CHECK(ray.Direction().X() == Approx(ray.Direction().Z()/5));
+
+    CHECK_THROWS_WITH(NuGeom::FluxWindow({0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {0, 0, 1}),
+                      "FluxWindow: Edges of the window are parallel");
+}
+
+TEST_CASE("Maximum path lengths", "[Flux]") {
+    FluxGeometry geometry;
+    NuGeom::FluxWindow window({-3, -3, -9}, {6, 0, 0}, {0, 6, 0}, {0, 0, 1});
+
+    NuGeom::MaxPathLengthOptions options;
+    options.nu = options.nv = 41;
+    options.safety_factor = 1;
+    auto maxima = NuGeom::MaxPathLengths(geometry.world, window, options);
+    REQUIRE(maxima.size() == NuGeom::MaterialTable::Global().Size());
+    // The center ray crosses the full diameter of the sphere and the water around it
+    CHECK(maxima[geometry.iron_id] == Approx(4*7.8));
+    CHECK(maxima[geometry.water_id] == Approx(19*1.0));
+
+    SECTION("Random rays and the safety factor") {
+        options.nu = options.nv = 1;
+        options.nrandom = 5000;
+        options.cone_angle = 0.1;
+        options.safety_factor = 1.2;
+        options.nthreads = 3;
+        auto random = NuGeom::MaxPathLengths(geometry.world, window, options);
+        CHECK(random[geometry.iron_id] <= 1.2*4*7.8 + 1e-8);
+        CHECK(random[geometry.iron_id] == Approx(1.2*4*7.8).epsilon(0.02));
+    }
+
+    SECTION("Cache") {
+        const auto directory = std::filesystem::temp_directory_path() / "nugeom_test_maxpl";
+        std::filesystem::create_directories(directory);
+        options.cache_directory = directory.string();
+        auto first = NuGeom::MaxPathLengths(geometry.world, window, options);
+        auto cached = NuGeom::MaxPathLengths(geometry.world, window, options);
+        CHECK(first == cached);
+        CHECK(cached == maxima);
+        CHECK(!std::filesystem::is_empty(directory));
+        std::filesystem::remove_all(directory);
+
+        // The key includes the geometry, so a different world does not pick up the cache
+        FluxGeometry other;
+        other.sphere -> AddDaughter(std::make_shared<PhysicalVolume>(
+            std::make_shared<LogicalVolume>(other.water, std::make_shared<NuGeom::Sphere>(1)),
+            NuGeom::Transform3D{}, NuGeom::Transform3D{}));
+        CHECK(other.world.Fingerprint() != geometry.world.Fingerprint());
+        CHECK(geometry.world.Fingerprint() == FluxGeometry().world.Fingerprint());
+    }
+}
+
+TEST_CASE("Fingerprint depends on the shape dimensions", "[Flux]") {
+    FluxGeometry geometry;
+    // Shapes of equal volume, which only differ in their dimensions or placement
+    auto fingerprint = [&](std::shared_ptr<NuGeom::Shape> shape) {
+        auto world_vol = std::make_shared<LogicalVolume>(geometry.water, std::move(shape));
+        return NuGeom::World(world_vol).Fingerprint();
+    };
+    const auto box = fingerprint(std::make_shared<NuGeom::Box>(NuGeom::Vector3D{1, 2, 8}));
+    CHECK(box == fingerprint(std::make_shared<NuGeom::Box>(NuGeom::Vector3D{1, 2, 8})));
+    CHECK(box != fingerprint(std::make_shared<NuGeom::Box>(NuGeom::Vector3D{8, 2, 1})));
+    CHECK(box != fingerprint(std::make_shared<NuGeom::Box>(NuGeom::Vector3D{1, 2, 8}, NuGeom::Rotation3D{},
+                                                           NuGeom::Translation3D{0, 0, 1})));
+    CHECK(fingerprint(std::make_shared<NuGeom::Cylinder>(1, 4))
+          != fingerprint(std::make_shared<NuGeom::Cylinder>(2, 1)));
+
+    auto unit_box = std::make_shared<NuGeom::Box>();
+    CHECK(fingerprint(std::make_shared<NuGeom::ScaledShape>(unit_box, NuGeom::Scale3D{1, 2, 8}))
+          != fingerprint(std::make_shared<NuGeom::ScaledShape>(unit_box, NuGeom::Scale3D{8, 2, 1})));
+    CHECK(fingerprint(std::make_shared<NuGeom::ScaledShape>(
+              std::make_shared<NuGeom::Box>(NuGeom::Vector3D{1, 2, 8}), NuGeom::Scale3D{2, 2, 2}))
+          != fingerprint(std::make_shared<NuGeom::ScaledShape>(
+              std::make_shared<NuGeom::Box>(NuGeom::Vector3D{8, 2, 1}), NuGeom::Scale3D{2, 2, 2})));
+}
+
+TEST_CASE("Density map", "[Flux]") {
+    FluxGeometry geometry;
+    NuGeom::FluxWindow window({-3, -3, -9}, {6, 0, 0}, {0, 6, 0}, {0, 0, 1});
+    auto map = NuGeom::DensityMap::Trace(geometry.world, window, 21, 15, 3);
+    REQUIRE(map.NMaterials() == NuGeom::MaterialTable::Global().Size());
+    CHECK(map.MaterialNames()[geometry.iron_id] == "Iron");
+
+    // The center pixel crosses the sphere, the corners only water
+    CHECK(map.Density(geometry.iron_id, 10, 7) == Approx(4*7.8));
+    CHECK(map.Density(geometry.water_id, 10, 7) == Approx(15*1.0));
+    CHECK(map.Total(10, 7) == Approx(4*7.8 + 15));
+    CHECK(map.Density(geometry.iron_id, 0, 14) == 0);
+    CHECK(map.Total(20, 0) == Approx(19*1.0));
+    // The ray of pixel (10, 2) touches the sphere
+    CHECK(map.Total(10, 2) == Approx(19*1.0));
+
+    size_t nwrong = 0;
+    auto serial = NuGeom::DensityMap::Trace(geometry.world, window, 21, 15, 1);
+    CHECK(serial.Densities() == map.Densities());
+    for(size_t pixel = 0; pixel < map.NPixels(); ++pixel) {
+        double sum = 0;
+        for(NuGeom::MaterialId id = 0; id < map.NMaterials(); ++id) sum += map.Densities()[id*map.NPixels() + pixel];
+        if(!(std::abs(sum - map.Totals()[pixel]) <= 1e-12)) ++nwrong;
+    }
+    CHECK(nwrong == 0);
+
+    const auto directory = std::filesystem::temp_directory_path() / "nugeom_test_density_map";
+    std::filesystem::create_directories(directory);
+    SECTION("Binary file") {
+        const auto filename = (directory / "map.bin").string();
+        map.Write(filename);
+        auto read = NuGeom::DensityMap::Read(filename);
+        CHECK(read.NU() == 21);
+        CHECK(read.NV() == 15);
+        CHECK(read.MaterialNames() == map.MaterialNames());
+        CHECK(read.Totals() == map.Totals());
+        CHECK(read.Densities() == map.Densities());
+        CHECK_THROWS_WITH(NuGeom::DensityMap::Read((directory / "missing.bin").string()),
+                          Catch::StartsWith("DensityMap: Could not open"));
+    }
+
+    SECTION("PNG") {
+        const auto filename = (directory / "iron.png").string();
+        map.WritePNG(filename, geometry.iron_id);
+        std::ifstream png(filename, std::ios::binary);
+        std::string signature(8, '\0');
+        png.read(signature.data(), 8);
+        CHECK(signature == "\x89PNG\r\n\x1a\n");
+        CHECK_THROWS_WITH(map.WritePNG(filename, static_cast<NuGeom::MaterialId>(map.NMaterials())),
+                          Catch::StartsWith("DensityMap: Undefined material id"));
+    }
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Importance sampled flux rays", "[Flux]") {
+    FluxGeometry geometry;
+    NuGeom::FluxWindow window({-3, -3, -9}, {6, 0, 0}, {0, 6, 0}, {0, 0, 1});
+    NuGeom::FluxSamplerOptions options;
+    options.nu = options.nv = 16;
+    options.material_weights.assign(NuGeom::MaterialTable::Global().Size(), 0);
+    options.material_weights[geometry.iron_id] = 1;
+    NuGeom::FluxSampler sampler(geometry.world, window, options);
+
+    // Pixels outside of the sphere only get the uniform fraction
+    CHECK(sampler.Probability(0, 0) == Approx(0.01/256));
+    CHECK(sampler.Probability(8, 8) > 1.0/256);
+
+    // The weighted mean column density of iron matches uniform sampling, which is the mass of
+    // the sphere over the area of the window, while most rays hit the sphere
+    constexpr size_t nrays = 20000;
+    size_t nhit = 0;
+    double sum = 0;
+    std::vector<double> column;
+    for(size_t i = 0; i < nrays; ++i) {
+        NuGeom::RandomStream rng(42, i);
+        auto ray = sampler.Sample(rng);
+        geometry.world.ColumnDensity(ray.ray, column);
+        if(column[geometry.iron_id] > 0) ++nhit;
+        sum += ray.weight*column[geometry.iron_id];
+    }
+    CHECK(static_cast<double>(nhit)/nrays > 0.9);
+    CHECK(sum/nrays == Approx(4.0/3*M_PI*8*7.8/36).epsilon(0.01));
+
+    CHECK_THROWS_WITH(NuGeom::FluxSampler(window, sampler.Map(), {1, 1, {1}, 0.01, 0}),
+                      Catch::StartsWith("FluxSampler: Expected a weight for each"));
+    options.uniform_fraction = 2;
+    CHECK_THROWS_WITH(NuGeom::FluxSampler(window, sampler.Map(), options),
+                      "FluxSampler: The uniform fraction has to be in [0, 1]");
+}
+
+TEST_CASE("Memory mapped flux files", "[Flux]") {
+    std::vector<NuGeom::FluxRecord> records;
+    for(size_t i = 0; i < 10; ++i) {
+        const double x = static_cast<double>(i);
+        records.push_back({{x, 0, -10}, {0, 0, 1}, 1000 + x, 0.5, 211, 1, 5000});
+    }
+    const auto directory = std::filesystem::temp_directory_path() / "nugeom_test_flux";
+    std::filesystem::create_directories(directory);
+    const auto filename = (directory / "flux.bin").string();
+    NuGeom::MappedFluxFile::Write(filename, records);
+
+    {
+        NuGeom::MappedFluxFile file(filename);
+        REQUIRE(file.Size() == 10);
+        CHECK(file[3].Position() == NuGeom::Vector3D{3, 0, -10});
+        CHECK(file[3].Direction() == NuGeom::Vector3D{0, 0, 1});
+        CHECK(file[9].energy == 1009);
+        CHECK(file[9].parent_pdg == 211);
+
+        auto stream = file.Stream();
+        auto batch = stream.Next(4);
+        CHECK(batch.size == 4);
+        CHECK(batch.records == file.Records());
+        CHECK(stream.Next(100).size == 6);
+        CHECK(stream.Next(100).Empty());
+
+        // Shards cover every record once, and keep the index of the records in the file
+        std::vector<size_t> sizes, firsts;
+        for(size_t shard = 0; shard < 4; ++shard) {
+            auto shard_stream = file.Shard(shard, 4);
+            sizes.push_back(shard_stream.Remaining());
+            firsts.push_back(shard_stream.Next(100).first);
+        }
+        CHECK(sizes == std::vector<size_t>{3, 3, 2, 2});
+        CHECK(firsts == std::vector<size_t>{0, 3, 6, 8});
+        CHECK_THROWS_WITH(file.Shard(4, 4), "MappedFluxFile: Shard 4 out of 4");
+    }
+
+    // Truncated files are rejected
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 8);
+    CHECK_THROWS_WITH(NuGeom::MappedFluxFile(filename), Catch::EndsWith("ends in a partial record"));
+    std::filesystem::resize_file(filename, 8);
+    CHECK_THROWS_WITH(NuGeom::MappedFluxFile(filename), Catch::EndsWith("is not a flux file"));
+    CHECK_THROWS_WITH(NuGeom::MappedFluxFile((directory / "missing.bin").string()),
+                      Catch::StartsWith("MappedFluxFile: Could not open"));
+    std::filesystem::remove_all(directory);
+}
@@ -1,6 +1,7 @@
 #include "catch2/catch.hpp"
 
 #include "geom/Material.hh"
+#include "geom/MaterialTable.hh"
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/ostream_sink.h"
 
@@ -51,10 +52,75 @@ TEST_CASE("Material", "[Materials]") {
         CHECK_THROWS_WITH(air.AddElement(NuGeom::Element("Dummy", 2, 2), 0.5),
                           Catch::Contains("Too many elements added"));
 
+        auto previous_logger = spdlog::default_logger();
         auto oss = test_logger();
         NuGeom::Material dummy("dummy", 1, 2);
         dummy.AddElement(NuGeom::Element("Nitrogen"), 0.7);
         dummy.AddElement(NuGeom::Element("Oxygen"), 0.7);
         CHECK_THAT(oss.str(), Catch::Contains("Mass fractions sum to 1.4 and not 1"));
+        // The stream goes out of scope with the section
+        spdlog::drop("test_log");
+        spdlog::set_default_logger(previous_logger);
+    }
+}
+
+TEST_CASE("Material table", "[Materials]") {
+    NuGeom::MaterialTable table;
+    CHECK(table.Size() == 1);
+    CHECK(table.Get(0).Name() == "");
+
+    NuGeom::Material water("water", 1.0, 2);
+    water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    NuGeom::Material heavy_water("water", 1.1, 2);
+    heavy_water.AddElement(NuGeom::Element("Hydrogen", 1, 2), 2);
+    heavy_water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+
+    auto id = table.Add(water);
+    CHECK(id == 1);
+    CHECK(table.Add(water) == id);
+    CHECK(table.Add(heavy_water) == 2);
+    CHECK(table.Get(id).Density() == 1.0);
+    CHECK(table.Get(2).Density() == 1.1);
+    CHECK_THROWS_WITH(table.Get(3), Catch::Equals("MaterialTable: Undefined material id 3"));
+}
+
+TEST_CASE("Alias table", "[Materials]") {
+    CHECK_THROWS_WITH(NuGeom::AliasTable(std::vector<double>{}), "AliasTable: No weights given");
+    CHECK_THROWS_WITH(NuGeom::AliasTable({1, -1}), "AliasTable: Weights must be non-negative");
+    CHECK_THROWS_WITH(NuGeom::AliasTable({0, 0}), "AliasTable: Weights sum to zero");
+
+    const std::vector<double> weights{0.1, 0.0, 2.5, 0.4, 1.0};
+    NuGeom::AliasTable table(weights);
+    REQUIRE(table.Size() == weights.size());
+    CHECK(table.Probability(2) == Approx(0.625));
+
+    // Scanning the unit interval reproduces the weights exactly up to the binning
+    constexpr size_t nsamples = 400000;
+    std::vector<double> counts(weights.size());
+    for(size_t i = 0; i < nsamples; ++i) {
+        counts[table.Sample((static_cast<double>(i) + 0.5)/nsamples)] += 1;
+    }
+    for(size_t i = 0; i < weights.size(); ++i) {
+        CHECK(counts[i]/nsamples == Approx(table.Probability(i)).margin(1e-4));
+    }
+    CHECK(table.Sample(0.999999999999) < weights.size());
+
+    CHECK_FALSE(table.Update(weights));
+    CHECK(table.Update({1, 1}));
+    CHECK(table.Size() == 2);
+
+    SECTION("Material sampling with custom weights") {
+        NuGeom::Material water("water", 1.0, 2);
+        water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+        water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+        auto number = water.NumberFractions();
+        CHECK(number[0]/number[1] == Approx(2));
+
+        NuGeom::AliasTable sampler({0, 1});
+        CHECK(water.SelectElement(0.01, sampler).Name() == "Oxygen");
+        CHECK(water.SelectElement(0.99, sampler).Name() == "Oxygen");
+        CHECK_THROWS_WITH(water.SelectElement(0.5, NuGeom::AliasTable({1, 1, 1})),
+                          "Material: Sampler does not match the number of elements");
     }
 }
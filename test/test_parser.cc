@@ -1,7 +1,11 @@
 #include <iostream>
 #include "catch2/catch.hpp"
 #include "geom/Parser.hh"
+#include "geom/LineSegment.hh"
+#include "geom/Ray.hh"
+#include "geom/World.hh"
 #include "geom/Logging.hh"
+#include "spdlog/spdlog.h"
 
 TEST_CASE("Parse define block", "[GDMLParser]") {
     // TODO: Figure out why default logger segfualts
@@ -105,3 +109,160 @@ TEST_CASE("Parse define block", "[GDMLParser]") {
                           Catch::Equals("GDMLParser: Undefined constant invalid"));
     }
 }
+
+TEST_CASE("Identical solids and volumes are shared", "[GDMLParser]") {
+    if(!spdlog::get("nugeom")) CreateLogger(false, 0, 1);
+    std::string input = R"xml(
+<?xml version="1.0"?>
+<gdml>
+  <define>
+    <position name="pos1" x="0" y="0" z="50" unit="cm"/>
+    <position name="pos2" x="0" y="0" z="-50" unit="cm"/>
+  </define>
+  <materials>
+    <element Z="1" formula="H" name="hydrogen">
+      <atom value="1.00794"/>
+    </element>
+    <material formula="" name="Hydrogen">
+      <D value="0.1"/>
+      <fraction n="1" ref="hydrogen"/>
+    </material>
+  </materials>
+  <solids>
+    <box name="World" x="300" y="300" z="300" lunit="cm"/>
+    <box name="BoxA" x="100" y="20" z="10" lunit="cm"/>
+    <box name="BoxB" lunit="cm" x="100.0" y="2e1" z="10"/>
+    <box name="BoxC" x="100" y="20" z="10" lunit="mm"/>
+  </solids>
+  <structure>
+    <volume name="VolA">
+      <materialref ref="Hydrogen"/>
+      <solidref ref="BoxA"/>
+    </volume>
+    <volume name="VolB">
+      <materialref ref="Hydrogen"/>
+      <solidref ref="BoxB"/>
+    </volume>
+    <volume name="VolC">
+      <materialref ref="Hydrogen"/>
+      <solidref ref="BoxC"/>
+    </volume>
+    <volume name="World">
+      <materialref ref="Hydrogen"/>
+      <solidref ref="World"/>
+      <physvol>
+        <volumeref ref="VolA"/>
+        <positionref ref="pos1"/>
+      </physvol>
+      <physvol>
+        <volumeref ref="VolB"/>
+        <positionref ref="pos2"/>
+      </physvol>
+    </volume>
+  </structure>
+  <setup name="default" version="1.0">
+    <world ref="World"/>
+  </setup>
+</gdml>)xml";
+
+    pugi::xml_document doc;
+    auto result = doc.load_string(input.c_str());
+    if(!result)
+        throw std::runtime_error("GDMLParser: Invalid file");
+    NuGeom::GDMLParser parser(doc);
+
+    CHECK(parser.GetShape("BoxA") == parser.GetShape("BoxB"));
+    CHECK(parser.GetShape("BoxA") != parser.GetShape("BoxC"));
+    CHECK(parser.GetVolume("VolA") == parser.GetVolume("VolB"));
+    CHECK(parser.GetVolume("VolA") != parser.GetVolume("VolC"));
+    CHECK(parser.GetVolume("World")->Daughters().size() == 2);
+    CHECK_THROWS_WITH(parser.GetVolume("invalid"),
+                      Catch::Equals("GDMLParser: Undefined volume invalid"));
+}
+
+TEST_CASE("Shared volumes leave into the mother they are placed in", "[GDMLParser]") {
+    if(!spdlog::get("nugeom")) CreateLogger(false, 0, 1);
+    // LeadA and LeadB are identical and share one logical volume, placed in two different mothers
+    std::string input = R"xml(
+<?xml version="1.0"?>
+<gdml>
+  <materials>
+    <element Z="1" formula="H" name="hydrogen">
+      <atom value="1.00794"/>
+    </element>
+    <element Z="8" formula="O" name="oxygen">
+      <atom value="15.999"/>
+    </element>
+    <element Z="26" formula="Fe" name="iron">
+      <atom value="55.845"/>
+    </element>
+    <element Z="82" formula="Pb" name="lead">
+      <atom value="207.2"/>
+    </element>
+    <material formula="" name="Water">
+      <D value="1"/>
+      <composite n="2" ref="hydrogen"/>
+      <composite n="1" ref="oxygen"/>
+    </material>
+    <material formula="" name="IronM">
+      <D value="7.87"/>
+      <fraction n="1" ref="iron"/>
+    </material>
+    <material formula="" name="Lead">
+      <D value="11.35"/>
+      <fraction n="1" ref="lead"/>
+    </material>
+  </materials>
+  <solids>
+    <box name="Module" x="10" y="10" z="10" lunit="cm"/>
+    <box name="Leaf" x="2" y="2" z="2" lunit="cm"/>
+  </solids>
+  <structure>
+    <volume name="LeadA">
+      <materialref ref="Lead"/>
+      <solidref ref="Leaf"/>
+    </volume>
+    <volume name="LeadB">
+      <materialref ref="Lead"/>
+      <solidref ref="Leaf"/>
+    </volume>
+    <volume name="WaterModule">
+      <materialref ref="Water"/>
+      <solidref ref="Module"/>
+      <physvol>
+        <volumeref ref="LeadA"/>
+      </physvol>
+    </volume>
+    <volume name="IronModule">
+      <materialref ref="IronM"/>
+      <solidref ref="Module"/>
+      <physvol>
+        <volumeref ref="LeadB"/>
+      </physvol>
+    </volume>
+  </structure>
+  <setup name="default" version="1.0">
+    <world ref="WaterModule"/>
+  </setup>
+</gdml>)xml";
+
+    pugi::xml_document doc;
+    auto result = doc.load_string(input.c_str());
+    if(!result)
+        throw std::runtime_error("GDMLParser: Invalid file");
+    NuGeom::GDMLParser parser(doc);
+    REQUIRE(parser.GetVolume("LeadA") == parser.GetVolume("LeadB"));
+
+    auto check_exit = [](const NuGeom::World &world, const std::string &mother) {
+        auto segments = world.GetLineSegments(NuGeom::Ray({-5, 0, 0}, {1, 0, 0}));
+        REQUIRE(segments.size() == 3);
+        CHECK(segments[0].GetMaterial().Name() == mother);
+        CHECK(segments[0].Length() == Approx(4));
+        CHECK(segments[1].GetMaterial().Name() == "Lead");
+        CHECK(segments[1].Length() == Approx(2));
+        CHECK(segments[2].GetMaterial().Name() == mother);
+        CHECK(segments[2].Length() == Approx(4));
+    };
+    check_exit(parser.GetWorld(), "Water");
+    check_exit(NuGeom::World(parser.GetVolume("IronModule")), "IronM");
+}
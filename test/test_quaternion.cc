@@ -0,0 +1,57 @@
+#include "catch2/catch.hpp"
+
+#include "geom/Quaternion.hh"
+
+namespace {
+
+void CheckVector(const NuGeom::Vector3D &result, const NuGeom::Vector3D &expected) {
+    CHECK(result.X() == Approx(expected.X()).margin(1e-12));
+    CHECK(result.Y() == Approx(expected.Y()).margin(1e-12));
+    CHECK(result.Z() == Approx(expected.Z()).margin(1e-12));
+}
+
+}
+
+TEST_CASE("Quaternion rotations", "[Quaternion]") {
+    const NuGeom::Vector3D input{0.3, -1.2, 2.5};
+
+    SECTION("Axis-angle matches Rotation3D") {
+        NuGeom::Vector3D axis{1, 2, -1};
+        auto quat = NuGeom::Quaternion::FromAxisAngle(axis, 0.7);
+        NuGeom::Rotation3D rot(axis, 0.7);
+        CheckVector(quat.Rotate(input), rot.Apply(input));
+        CheckVector(quat.ToRotation().Apply(input), rot.Apply(input));
+    }
+
+    SECTION("Euler angles match the matrix product") {
+        auto quat = NuGeom::Quaternion::FromEuler(0.1, -0.5, 2.0);
+        auto rot = NuGeom::RotationZ3D(2.0)*NuGeom::RotationY3D(-0.5)*NuGeom::RotationX3D(0.1);
+        CheckVector(quat.Rotate(input), rot.Apply(input));
+    }
+
+    SECTION("Round trip through a rotation matrix") {
+        for(double angle : {0.2, 1.5, 3.0, -2.9}) {
+            for(const auto &axis : {NuGeom::UnitX, NuGeom::UnitY, NuGeom::UnitZ, NuGeom::Vector3D{1, 1, 1}}) {
+                auto quat = NuGeom::Quaternion::FromAxisAngle(axis, angle);
+                auto back = NuGeom::Quaternion::FromRotation(quat.ToRotation());
+                CheckVector(back.Rotate(input), quat.Rotate(input));
+            }
+        }
+    }
+}
+
+TEST_CASE("Rigid transforms", "[Quaternion]") {
+    const NuGeom::Vector3D input{0.3, -1.2, 2.5};
+    NuGeom::Transform3D parent = NuGeom::Translation3D(1, 2, 3)*NuGeom::RotationX3D(0.4);
+    NuGeom::Transform3D child = NuGeom::Translation3D(-2, 0, 1)*NuGeom::RotationZ3D(1.1);
+    NuGeom::RigidTransform3D rigid_parent(parent), rigid_child(child);
+
+    CheckVector(rigid_parent.Apply(input), parent.Apply(input));
+    CheckVector((rigid_parent*rigid_child).Apply(input), (parent*child).Apply(input));
+    CheckVector(rigid_parent.Inverse().Apply(rigid_parent.Apply(input)), input);
+    CheckVector((rigid_parent*rigid_child).ToTransform().Apply(input), (parent*child).Apply(input));
+    CHECK_THROWS_WITH(NuGeom::RigidTransform3D(NuGeom::Scale3D(1, 2, 1)),
+                      Catch::Equals("RigidTransform3D: Transform is not a rotation and translation"));
+    CHECK_THROWS_WITH(NuGeom::RigidTransform3D(NuGeom::Scale3D(1, -1, 1)),
+                      Catch::Equals("RigidTransform3D: Transform is not a rotation and translation"));
+}
@@ -0,0 +1,51 @@
+#include "catch2/catch.hpp"
+
+#include "geom/Random.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+
+TEST_CASE("Philox known answers", "[Random]") {
+    using NuGeom::Philox4x32;
+    // Reference vectors of the Random123 distribution
+    static_assert(Philox4x32::Generate({0, 0, 0, 0}, {0, 0})[0] == 0x6627e8d5);
+    CHECK(Philox4x32::Generate({0, 0, 0, 0}, {0, 0})
+          == Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+    CHECK(Philox4x32::Generate({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff})
+          == Philox4x32::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+    CHECK(Philox4x32::Generate({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0})
+          == Philox4x32::Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+}
+
+TEST_CASE("Random streams", "[Random]") {
+    NuGeom::RandomStream stream(42, 7), same(42, 7), other_event(42, 8), other_seed(43, 7);
+    std::set<uint64_t> values;
+    for(size_t i = 0; i < 100; ++i) {
+        auto value = stream();
+        CHECK(value == same());
+        CHECK(value != other_event());
+        CHECK(value != other_seed());
+        values.insert(value);
+    }
+    CHECK(values.size() == 100);
+
+    NuGeom::RandomStream uniform(1, 0);
+    double sum = 0, min = 1, max = 0;
+    constexpr size_t nsamples = 100000;
+    for(size_t i = 0; i < nsamples; ++i) {
+        double value = uniform.Uniform();
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+    }
+    CHECK(min >= 0);
+    CHECK(max < 1);
+    CHECK(sum/nsamples == Approx(0.5).margin(0.005));
+
+    // Works with the standard distributions
+    NuGeom::RandomStream engine(1, 1);
+    std::normal_distribution<double> normal;
+    CHECK(std::isfinite(normal(engine)));
+}
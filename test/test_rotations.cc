@@ -1,5 +1,6 @@
 #include "catch2/catch.hpp"
 
+#include "geom/Shape.hh"
 #include "geom/Transform3D.hh"
 #include <iostream>
 
@@ -35,3 +36,71 @@ TEST_CASE("Multiple Rotations", "[Transform3D]") {
         CHECK(result.Z() == Approx(expected.Z()).margin(1e-10));
     }
 }
+
+TEST_CASE("Transform kinds", "[Transform3D]") {
+    using Kind = NuGeom::Transform3D::Kind;
+    NuGeom::RotationZ3D rot(0.3);
+    NuGeom::Translation3D trans(1, 2, 3);
+    NuGeom::Scale3D scale(1, 2, 1);
+
+    CHECK(NuGeom::Transform3D().GetKind() == Kind::Identity);
+    CHECK(trans.GetKind() == Kind::Translation);
+    CHECK(rot.GetKind() == Kind::Rotation);
+    CHECK((trans*rot).GetKind() == Kind::RotationTranslation);
+    CHECK((trans*scale).GetKind() == Kind::General);
+
+    SECTION("Cached inverse undoes the transform") {
+        const NuGeom::Vector3D input{0.5, -1, 2};
+        for(const auto &transform : {NuGeom::Transform3D(trans), NuGeom::Transform3D(rot),
+                                     trans*rot, trans*rot*scale}) {
+            NuGeom::CachedTransform3D cached(transform);
+            auto result = cached.ApplyInverse(cached.Apply(input));
+            CHECK(result.X() == Approx(input.X()).margin(1e-12));
+            CHECK(result.Y() == Approx(input.Y()).margin(1e-12));
+            CHECK(result.Z() == Approx(input.Z()).margin(1e-12));
+        }
+    }
+}
+
+TEST_CASE("Ray times under general transforms", "[Transform3D]") {
+    // The unit box in the transformed frame is a box with half widths (0.25, 0.125, 0.5)
+    NuGeom::Scale3D scale(2, 4, 1);
+    NuGeom::Ray ray({-1, -1, 0}, {1, 1, 0});
+    double length{};
+    auto local = scale.Apply(ray, length);
+    CHECK(length == Approx(std::sqrt(10)));
+    CHECK(local.Direction().Norm() == Approx(1));
+
+    // Analytic hit in the original frame: the ray enters the slab |y| < 0.125 last, at y = -0.125
+    const double expected = 0.875*std::sqrt(2);
+    NuGeom::Box box;
+    CHECK(box.Intersect(local)/length == Approx(expected));
+    CHECK(ray.Propagate(box.Intersect(local)/length).Y() == Approx(-0.125));
+
+    // Rigid transforms leave the times unchanged
+    NuGeom::RotationZ3D rot(0.3);
+    rot.Apply(ray, length);
+    CHECK(length == 1);
+}
+
+TEST_CASE("Compile time transforms", "[Transform3D]") {
+    // Fixed placements are folded by the compiler
+    constexpr NuGeom::RotationX3D rot(M_PI_2);
+    constexpr NuGeom::Translation3D trans(1, 2, 3);
+    constexpr auto transform = trans*rot;
+    constexpr auto result = transform.Apply(NuGeom::UnitY);
+    static_assert(NuGeom::Math::Abs(result.X() - 1) < 1e-15, "Rotation is not evaluated at compile time");
+    static_assert(NuGeom::Math::Abs(result.Y() - 2) < 1e-15, "Rotation is not evaluated at compile time");
+    static_assert(NuGeom::Math::Abs(result.Z() - 4) < 1e-15, "Rotation is not evaluated at compile time");
+    static_assert(transform.GetKind() == NuGeom::Transform3D::Kind::RotationTranslation, "Wrong kind");
+    static_assert(transform.Inverse().Apply(result).Y() < 1 + 1e-15, "Inverse is not evaluated at compile time");
+
+    SECTION("Compile time values match the run time ones") {
+        NuGeom::RotationX3D runtime_rot(M_PI_2);
+        auto expected = (NuGeom::Translation3D(1, 2, 3)*runtime_rot).Apply(NuGeom::UnitY);
+        CHECK(result.X() == Approx(expected.X()).margin(1e-15));
+        CHECK(result.Y() == Approx(expected.Y()).margin(1e-15));
+        CHECK(result.Z() == Approx(expected.Z()).margin(1e-15));
+        CHECK(NuGeom::Math::Sqrt(2.0) == std::sqrt(2.0));
+    }
+}
@@ -1,5 +1,7 @@
 #include "catch2/catch.hpp"
 #include "geom/Shape.hh"
+#include "geom/Ray.hh"
+#include "pugixml.hpp"
 
 TEST_CASE("Box", "[Shapes]") {
     SECTION("SDF is correct") {
@@ -108,7 +110,78 @@ TEST_CASE("Cylinder", "[Shapes]") {
 
     SECTION("Volume is correct") {
         NuGeom::Cylinder cylinder;
-        CHECK(cylinder.Volume() == Approx(M_PI));
+        CHECK(cylinder.Volume() == Approx(2*M_PI));
+    }
+
+    SECTION("Volume matches traced chord lengths") {
+        NuGeom::Cylinder cylinder(1.5, 0.75);
+        // Integrate the chords of rays along x over the cross section in the yz-plane
+        constexpr size_t ny = 1000, nz = 10;
+        const double dy = 3.0/ny, dz = 1.5/nz;
+        double volume = 0;
+        for(size_t i = 0; i < ny; ++i) {
+            for(size_t j = 0; j < nz; ++j) {
+                NuGeom::Ray ray({-5, -1.5 + (static_cast<double>(i) + 0.5)*dy,
+                                 -0.75 + (static_cast<double>(j) + 0.5)*dz}, {1, 0, 0});
+                const double enter = cylinder.Intersect(ray);
+                if(enter == std::numeric_limits<double>::infinity()) continue;
+                const double exit = cylinder.Intersect(NuGeom::Ray(ray.Propagate(enter + 1e-9), {1, 0, 0}));
+                volume += (exit + 1e-9)*dy*dz;
+            }
+        }
+        CHECK(volume == Approx(cylinder.Volume()).epsilon(1e-4));
+    }
+
+    SECTION("GDML tubes give the full length") {
+        pugi::xml_document doc;
+        doc.load_string(R"(<tube name="Tube" rmax="2" z="4"/>)");
+        auto tube = NuGeom::ShapeFactory::Initialize("tube", doc.child("tube"));
+        CHECK(tube -> Volume() == Approx(16*M_PI));
+        CHECK(tube -> SignedDistance({0, 0, 2}) == Approx(0).margin(1e-15));
+        CHECK(tube -> Intersect(NuGeom::Ray({0, 0, -5}, {0, 0, 1})) == Approx(3));
+    }
+}
+
+TEST_CASE("Scaled Shape", "[Shapes]") {
+    auto sphere = std::make_shared<NuGeom::Sphere>(1);
+    auto box = std::make_shared<NuGeom::Box>();
+
+    SECTION("Uniform scale is exact") {
+        NuGeom::ScaledShape shape(sphere, NuGeom::Scale3D(2, 2, 2));
+        CHECK(shape.SignedDistance({0, 0, 0}) == -2);
+        CHECK(shape.SignedDistance({0, 3, 0}) == 1);
+        CHECK(shape.Volume() == Approx(8*sphere -> Volume()));
+    }
+
+    SECTION("Non-uniform scale") {
+        NuGeom::ScaledShape shape(box, NuGeom::Scale3D(2, 4, 6));
+        CHECK(shape.Volume() == Approx(48));
+        CHECK(shape.Contains({0.9, 1.9, 2.9}) == NuGeom::Location::kInterior);
+        CHECK(shape.Contains({1.1, 0, 0}) == NuGeom::Location::kExterior);
+        CHECK(shape.Contains({0, 2.1, 0}) == NuGeom::Location::kExterior);
+
+        NuGeom::Ray ray({0, -5, 0}, {0, 1, 0});
+        CHECK_THAT(shape.Intersect(ray), Catch::WithinAbs(3, 1e-12));
+        ray = NuGeom::Ray({0, 0, 0}, {0, 0, 1});
+        CHECK_THAT(shape.Intersect(ray), Catch::WithinAbs(3, 1e-12));
+    }
+
+    SECTION("Reflected and translated shape") {
+        auto offset = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{1, 1, 1}, NuGeom::Rotation3D{},
+                                                    NuGeom::Translation3D{0, 0, 2});
+        NuGeom::ScaledShape mirror(offset, NuGeom::ScaleZ3D(-1), NuGeom::Rotation3D{},
+                                   NuGeom::Translation3D{1, 0, 0});
+        CHECK(mirror.Volume() == Approx(1));
+        CHECK(mirror.Contains({1, 0, -2}) == NuGeom::Location::kInterior);
+        CHECK(mirror.Contains({1, 0, 2}) == NuGeom::Location::kExterior);
+
+        NuGeom::Ray ray({1, 0, 0}, {0, 0, -1});
+        CHECK_THAT(mirror.Intersect(ray), Catch::WithinAbs(1.5, 1e-12));
+    }
+
+    SECTION("Zero scale is rejected") {
+        CHECK_THROWS_WITH(NuGeom::ScaledShape(box, NuGeom::Scale3D(1, 0, 1)),
+                          Catch::Contains("must be non-zero"));
     }
 }
 
@@ -171,3 +244,163 @@ TEST_CASE("Combined Shape", "[Shapes]") {
         CHECK(shape.SignedDistance(point) != shape2.SignedDistance(point));
     }
 }
+
+TEST_CASE("Shape kernels", "[Shapes]") {
+    NuGeom::Rotation3D rotation{{1, 1, 0}, 30*M_PI/180};
+    NuGeom::Translation3D translation{0.5, -1, 2};
+    auto box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{1, 2, 3}, rotation, translation);
+    auto sphere = std::make_shared<NuGeom::Sphere>(1.5, rotation, translation);
+    auto cylinder = std::make_shared<NuGeom::Cylinder>(1, 2, rotation, translation);
+    auto scaled = std::make_shared<NuGeom::ScaledShape>(box, NuGeom::Scale3D(1, -2, 1));
+    NuGeom::Vector3D point = GENERATE(take(30, randomPoint(-5, 5)));
+    NuGeom::Ray ray(point, NuGeom::Vector3D{0.5, -1, 2} - point);
+
+    SECTION("Built-in shapes use dedicated kernels") {
+        CHECK_FALSE(box -> GetKernel().IsGeneric());
+        CHECK_FALSE(sphere -> GetKernel().IsGeneric());
+        CHECK_FALSE(cylinder -> GetKernel().IsGeneric());
+        CHECK(scaled -> GetKernel().IsGeneric());
+    }
+
+    SECTION("Kernels match the virtual interface") {
+        for(const auto &shape : std::vector<std::shared_ptr<NuGeom::Shape>>{box, sphere, cylinder, scaled}) {
+            auto kernel = shape -> GetKernel();
+            CHECK(kernel.SignedDistance(point) == Approx(shape -> SignedDistance(point)).margin(1e-12));
+            CHECK(kernel.Intersect(ray) == Approx(shape -> Intersect(ray)).margin(1e-12));
+        }
+    }
+
+    SECTION("Single precision kernels agree with double precision") {
+        for(const auto &shape : std::vector<std::shared_ptr<NuGeom::Shape>>{box, sphere, cylinder, scaled}) {
+            auto kernel = shape -> GetKernel();
+            NuGeom::ShapeKernelF kernel_single(kernel);
+            CHECK(kernel_single.IsGeneric() == kernel.IsGeneric());
+            CHECK(kernel_single.SignedDistance(NuGeom::Vector3F(point))
+                  == Approx(kernel.SignedDistance(point)).margin(1e-4));
+            CHECK(kernel_single.Intersect(NuGeom::RayF(ray)) == Approx(kernel.Intersect(ray)).margin(1e-4));
+        }
+    }
+}
+
+TEST_CASE("Quadratic solver", "[Shapes]") {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+
+    SECTION("Roots are ordered") {
+        auto roots = NuGeom::Kernel::SolveQuadratic(1.0, -1.0, -6.0);
+        CHECK(roots.first == -2);
+        CHECK(roots.second == 3);
+        roots = NuGeom::Kernel::SolveQuadratic(-1.0, 1.0, 6.0);
+        CHECK(roots.first == -2);
+        CHECK(roots.second == 3);
+    }
+
+    SECTION("No real roots") {
+        auto roots = NuGeom::Kernel::SolveQuadratic(1.0, 0.0, 1.0);
+        CHECK(roots.first == inf);
+        CHECK(roots.second == inf);
+    }
+
+    SECTION("Linear equation") {
+        auto roots = NuGeom::Kernel::SolveQuadratic(0.0, 2.0, -4.0);
+        CHECK(roots.second == 2);
+    }
+
+    SECTION("Small root does not suffer from cancellation") {
+        // Roots are 1e8 and 1e-8, the naive formula loses all digits of the small root
+        auto roots = NuGeom::Kernel::SolveQuadratic(1.0, -(1e8 + 1e-8), 1.0);
+        CHECK(roots.first == Approx(1e-8).epsilon(1e-12));
+        CHECK(roots.second == Approx(1e8).epsilon(1e-12));
+    }
+
+    SECTION("Batched solver matches scalar solver") {
+        std::vector<float> a{1, 1, 0, 2}, b{-1, 0, 2, 3}, c{-6, 1, -4, -2};
+        std::vector<float> t0(a.size()), t1(a.size());
+        NuGeom::Kernel::SolveQuadratic(a.size(), a.data(), b.data(), c.data(), t0.data(), t1.data());
+        for(size_t i = 0; i < a.size(); ++i) {
+            auto roots = NuGeom::Kernel::SolveQuadratic(a[i], b[i], c[i]);
+            CHECK(t0[i] == roots.first);
+            CHECK(t1[i] == roots.second);
+        }
+    }
+}
+
+TEST_CASE("Quadric intersections", "[Shapes]") {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+
+    SECTION("Sphere") {
+        NuGeom::Sphere sphere(2);
+        CHECK(sphere.Intersect(NuGeom::Ray({0, 0, -5}, {0, 0, 1})) == Approx(3));
+        CHECK(sphere.Intersect(NuGeom::Ray({0, 0, 0}, {1, 0, 0})) == Approx(2));
+        CHECK(sphere.Intersect(NuGeom::Ray({0, 0, 5}, {0, 0, 1})) == inf);
+        CHECK(sphere.Intersect(NuGeom::Ray({0, 3, -5}, {0, 0, 1})) == inf);
+        // Grazing ray touches the sphere at a single point
+        CHECK(sphere.Intersect(NuGeom::Ray({0, 2, -5}, {0, 0, 1})) == Approx(5));
+    }
+
+    SECTION("Translated sphere") {
+        NuGeom::Sphere sphere{2, {}, {1, 2, 3}};
+        CHECK(sphere.Intersect(NuGeom::Ray({1, 2, -5}, {0, 0, 1})) == Approx(6));
+    }
+
+    SECTION("Cylinder side") {
+        NuGeom::Cylinder cylinder(2, 1);
+        CHECK(cylinder.Intersect(NuGeom::Ray({-5, 0, 0}, {1, 0, 0})) == Approx(3));
+        CHECK(cylinder.Intersect(NuGeom::Ray({0, 0, 0}, {0, 1, 0})) == Approx(2));
+        CHECK(cylinder.Intersect(NuGeom::Ray({-5, 0, 1.5}, {1, 0, 0})) == inf);
+        CHECK(cylinder.Intersect(NuGeom::Ray({-5, 3, 0}, {1, 0, 0})) == inf);
+    }
+
+    SECTION("Cylinder endcaps") {
+        NuGeom::Cylinder cylinder(2, 1);
+        CHECK(cylinder.Intersect(NuGeom::Ray({0, 0, -5}, {0, 0, 1})) == Approx(4));
+        CHECK(cylinder.Intersect(NuGeom::Ray({1, 1, 0}, {0, 0, -1})) == Approx(1));
+        CHECK(cylinder.Intersect(NuGeom::Ray({3, 0, -5}, {0, 0, 1})) == inf);
+        // Oblique ray entering through the bottom cap and leaving through the side
+        NuGeom::Ray ray({0, 0, -2}, {1, 0, 1});
+        CHECK(cylinder.Intersect(ray) == Approx(sqrt(2)));
+    }
+
+    SECTION("Intersections lie on the surface") {
+        NuGeom::Sphere sphere(1.5, {{1, 0, 0}, 0.3}, {0.2, -0.1, 0.4});
+        NuGeom::Cylinder cylinder(1.5, 0.75, {{1, 0, 0}, 0.3}, {0.2, -0.1, 0.4});
+        NuGeom::Vector3D point = GENERATE(take(30, randomPoint(-5, 5)));
+        NuGeom::Ray ray(point, NuGeom::Vector3D{0.2, -0.1, 0.4} - point);
+        for(const NuGeom::Shape *shape : std::vector<const NuGeom::Shape*>{&sphere, &cylinder}) {
+            double time = shape -> Intersect(ray);
+            REQUIRE(time < inf);
+            CHECK(shape -> SignedDistance(ray.Propagate(time)) == Approx(0).margin(1e-10));
+        }
+    }
+}
+
+TEST_CASE("Prepared rays", "[Shapes]") {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    NuGeom::Ray ray({0, 0, -5}, {0, -2, 2});
+    CHECK(ray.InverseDirection().Y() == Approx(-std::sqrt(2)));
+    CHECK(ray.Sign(0) == 0);
+    CHECK(ray.Sign(1) == 1);
+    CHECK(ray.Sign(2) == 0);
+    CHECK(ray.MaxDistance() == inf);
+
+    SECTION("Box slab test along every octant") {
+        NuGeom::Box box({2, 2, 2});
+        for(double x : {-1.0, 1.0}) {
+            for(double y : {-1.0, 1.0}) {
+                for(double z : {-1.0, 1.0}) {
+                    NuGeom::Vector3D dir{x, y, z};
+                    CHECK(box.Intersect(NuGeom::Ray(-3*dir, dir)) == Approx(2*std::sqrt(3)));
+                }
+            }
+        }
+        // Axis aligned rays with a signed zero direction
+        CHECK(box.Intersect(NuGeom::Ray({0.5, 0, -3}, {-0.0, 0, 1})) == Approx(2));
+        CHECK(box.Intersect(NuGeom::Ray({1.5, 0, -3}, {-0.0, 0, 1})) == inf);
+    }
+
+    SECTION("Hits beyond the max distance are misses") {
+        NuGeom::Sphere sphere(1);
+        CHECK(sphere.Intersect(NuGeom::Ray({0, 0, -5}, {0, 0, 1}, true, 4.5)) == Approx(4));
+        CHECK(sphere.Intersect(NuGeom::Ray({0, 0, -5}, {0, 0, 1}, true, 3.5)) == inf);
+        CHECK(sphere.GetKernel().Intersect(NuGeom::Ray({0, 0, -5}, {0, 0, 1}, true, 3.5)) == inf);
+    }
+}
@@ -3,10 +3,33 @@
 #include "geom/Volume.hh"
 #include "geom/Ray.hh"
 #include "geom/LineSegment.hh"
+#include "geom/RayBatch.hh"
+#include "geom/World.hh"
+
+#include <algorithm>
+#include <numeric>
 
 using NuGeom::LogicalVolume;
 using NuGeom::PhysicalVolume;
 
+namespace {
+
+// The batched traversal has to find the same segments as tracing the rays one at a time
+void CheckBatchedSegments(const NuGeom::World &world, const std::vector<NuGeom::Ray> &rays) {
+    const auto batched = world.GetLineSegments(NuGeom::RayBatch(rays));
+    REQUIRE(batched.size() == rays.size());
+    for(size_t i = 0; i < rays.size(); ++i) {
+        const auto single = world.GetLineSegments(rays[i]);
+        REQUIRE(batched[i].size() == single.size());
+        for(size_t j = 0; j < single.size(); ++j) {
+            CHECK_THAT(batched[i][j].Length(), Catch::WithinAbs(single[j].Length(), 1e-8));
+            CHECK(batched[i][j].GetMaterialId() == single[j].GetMaterialId());
+        }
+    }
+}
+
+}
+
 TEST_CASE("Single LogicalVolume", "[Volume]") {
     NuGeom::Material mat("Water", 1.0, 2);
     mat.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
@@ -86,4 +109,267 @@ TEST_CASE("Line Segments", "[Volume]") {
     CHECK_THAT(segments[4].Start().Z(), Catch::WithinAbs(segments[3].End().Z(), 1e-8));
     CHECK_THAT(segments[4].End().Z(), Catch::WithinAbs(2, 1e-8));
     CHECK_THAT(segments[1].Start().Z(), Catch::WithinAbs(-1, 1e-8));
+
+    SECTION("Segment records") {
+        std::vector<NuGeom::SegmentRecord> records;
+        world->GetSegments(ray, records);
+        // Records are appended to the buffer
+        world->GetSegments(ray, records);
+        REQUIRE(records.size() == 2*segments.size());
+        const std::vector<uint32_t> ids{world->GetId(), outer_vol->GetId(), inner_vol->GetId(),
+                                        outer_vol->GetId(), world->GetId()};
+        for(size_t i = 0; i < segments.size(); ++i) {
+            CHECK_THAT(records[i].Length(), Catch::WithinAbs(segments[i].Length(), 1e-12));
+            CHECK(records[i].material == segments[i].GetMaterialId());
+            CHECK(records[i].volume == ids[i]);
+            CHECK(records[i].t_start == records[i + segments.size()].t_start);
+        }
+        for(size_t i = 1; i < segments.size(); ++i) {
+            CHECK(records[i].t_start == records[i-1].t_end);
+        }
+        CHECK_THAT(records[segments.size()-1].t_end, Catch::WithinAbs(4, 1e-8));
+    }
+}
+
+TEST_CASE("Single precision navigation", "[Volume]") {
+    NuGeom::Material mat("Water", 1.0, 2);
+    mat.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    mat.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    auto world_box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{100, 100, 100});
+    auto world = std::make_shared<LogicalVolume>(mat, world_box);
+    auto box = std::make_shared<NuGeom::Box>();
+    auto vol = std::make_shared<LogicalVolume>(mat, box);
+    // Two daughters whose faces are closer than single precision can resolve
+    auto near = std::make_shared<PhysicalVolume>(vol, NuGeom::Translation3D{0, 0, 10}, NuGeom::Transform3D{});
+    auto far = std::make_shared<PhysicalVolume>(vol, NuGeom::Translation3D{0, 0, 10-1e-9}, NuGeom::Transform3D{});
+    auto miss = std::make_shared<PhysicalVolume>(vol, NuGeom::Translation3D{10, 0, 0}, NuGeom::Transform3D{});
+    world -> AddDaughter(miss);
+    world -> AddDaughter(near);
+    world -> AddDaughter(far);
+
+    NuGeom::Ray ray({0, 0, -40}, {0, 0, 1});
+    double time_double = 0, time_single = 0;
+    std::shared_ptr<PhysicalVolume> pvol_double, pvol_single;
+    CHECK(world -> RayTrace(ray, time_double, pvol_double));
+    CHECK(world -> RayTraceSingle(ray, time_single, pvol_single));
+    CHECK(pvol_single == pvol_double);
+    CHECK(time_single == time_double);
+}
+
+TEST_CASE("Rotated and translated placement", "[Volume]") {
+    NuGeom::Material mat("Water", 1.0, 2);
+    mat.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    mat.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    auto box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{1, 2, 4});
+    auto vol = std::make_shared<LogicalVolume>(mat, box);
+    PhysicalVolume pvol(vol, NuGeom::Translation3D{0, 0, 5}, NuGeom::RotationX3D(M_PI_2));
+
+    // The intersection and the signed distance have to agree on where the surface is
+    NuGeom::Ray ray({0, 0, -10}, {0, 0, 1});
+    double time = pvol.Intersect(ray);
+    CHECK_THAT(time, Catch::WithinAbs(14, 1e-8));
+    CHECK_THAT(pvol.SignedDistance(ray.Propagate(time)), Catch::WithinAbs(0, 1e-8));
+}
+
+TEST_CASE("Reflected placement", "[Volume]") {
+    NuGeom::Material water("Water", 1.0, 2);
+    water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    NuGeom::Material iron("Iron", 7.8, 1);
+    iron.AddElement(NuGeom::Element("Iron", 26, 56), 1);
+    NuGeom::Material lead("Lead", 11.35, 1);
+    lead.AddElement(NuGeom::Element(82), 1);
+
+    // The inner box sits at x in [0.5, 1.5] of the outer box, which is mirrored in x and
+    // moved to x = 1, so the inner box ends up at x in [-0.5, 0.5]
+    auto inner_vol = std::make_shared<LogicalVolume>(lead, std::make_shared<NuGeom::Box>());
+    auto inner_pvol = std::make_shared<PhysicalVolume>(inner_vol, NuGeom::Translation3D{1, 0, 0},
+                                                       NuGeom::Transform3D{});
+    auto outer_vol = std::make_shared<LogicalVolume>(iron, std::make_shared<NuGeom::Box>(NuGeom::Vector3D{4, 4, 4}));
+    outer_vol -> AddDaughter(inner_pvol);
+    inner_vol -> SetMother(outer_vol);
+    std::shared_ptr<PhysicalVolume> outer_pvol;
+    REQUIRE_NOTHROW(outer_pvol = std::make_shared<PhysicalVolume>(outer_vol, NuGeom::Translation3D{1, 0, 0},
+                                                                  NuGeom::Scale3D{-1, 1, 1}));
+    inner_pvol -> SetMother(outer_pvol);
+
+    auto world = std::make_shared<LogicalVolume>(water, std::make_shared<NuGeom::Box>(NuGeom::Vector3D{10, 10, 10}));
+    outer_vol -> SetMother(world);
+    world -> AddDaughter(outer_pvol);
+
+    std::vector<NuGeom::LineSegment> segments;
+    world -> GetLineSegments(NuGeom::Ray({-5, 0.2, 0.3}, {1, 0, 0}), segments);
+    REQUIRE(segments.size() == 5);
+    const std::vector<double> lengths{4, 0.5, 1, 2.5, 2};
+    const std::vector<NuGeom::MaterialId> materials{world -> GetMaterialId(), outer_vol -> GetMaterialId(),
+                                                    inner_vol -> GetMaterialId(), outer_vol -> GetMaterialId(),
+                                                    world -> GetMaterialId()};
+    for(size_t i = 0; i < segments.size(); ++i) {
+        CHECK_THAT(segments[i].Length(), Catch::WithinAbs(lengths[i], 1e-6));
+        CHECK(segments[i].GetMaterialId() == materials[i]);
+    }
+
+    std::vector<NuGeom::Ray> rays;
+    for(double y = -4.5; y <= 4.5; y += 0.75) {
+        rays.emplace_back(NuGeom::Vector3D{-5, y, 0.3}, NuGeom::Vector3D{1, 0, 0});
+        rays.emplace_back(NuGeom::Vector3D{-5, y, 0.3}, NuGeom::Vector3D{1, 0.3, 0.1});
+    }
+    CheckBatchedSegments(NuGeom::World(world), rays);
+}
+
+TEST_CASE("Scaled placement", "[Volume]") {
+    NuGeom::Material water("Water", 1.0, 2);
+    water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    NuGeom::Material iron("Iron", 7.8, 1);
+    iron.AddElement(NuGeom::Element("Iron", 26, 56), 1);
+    NuGeom::Material lead("Lead", 11.35, 1);
+    lead.AddElement(NuGeom::Element(82), 1);
+
+    // The outer box is doubled in size to x in [-4, 4], which moves the inner box
+    // from x in [0.5, 1.5] of the outer box to x in [1, 3]
+    auto inner_vol = std::make_shared<LogicalVolume>(lead, std::make_shared<NuGeom::Box>());
+    auto inner_pvol = std::make_shared<PhysicalVolume>(inner_vol, NuGeom::Translation3D{1, 0, 0},
+                                                       NuGeom::Transform3D{});
+    auto outer_vol = std::make_shared<LogicalVolume>(iron, std::make_shared<NuGeom::Box>(NuGeom::Vector3D{4, 4, 4}));
+    outer_vol -> AddDaughter(inner_pvol);
+    inner_vol -> SetMother(outer_vol);
+    auto outer_pvol = std::make_shared<PhysicalVolume>(outer_vol, NuGeom::Transform3D{},
+                                                       NuGeom::Scale3D{2, 2, 2});
+    inner_pvol -> SetMother(outer_pvol);
+
+    auto world = std::make_shared<LogicalVolume>(water, std::make_shared<NuGeom::Box>(NuGeom::Vector3D{10, 10, 10}));
+    outer_vol -> SetMother(world);
+    world -> AddDaughter(outer_pvol);
+
+    // Hit times are measured along the ray in the frame of the mother
+    CHECK_THAT(outer_pvol -> Intersect(NuGeom::Ray({-5, 0, 0}, {1, 0, 0})), Catch::WithinAbs(1, 1e-6));
+    CHECK_THAT(outer_pvol -> IntersectSingle(NuGeom::Ray({-5, 0, 0}, {1, 0, 0})), Catch::WithinAbs(1, 1e-5));
+
+    std::vector<NuGeom::LineSegment> segments;
+    world -> GetLineSegments(NuGeom::Ray({-5, 0.2, 0.3}, {1, 0, 0}), segments);
+    REQUIRE(segments.size() == 5);
+    const std::vector<double> lengths{1, 5, 2, 1, 1};
+    const std::vector<NuGeom::MaterialId> materials{world -> GetMaterialId(), outer_vol -> GetMaterialId(),
+                                                    inner_vol -> GetMaterialId(), outer_vol -> GetMaterialId(),
+                                                    world -> GetMaterialId()};
+    for(size_t i = 0; i < segments.size(); ++i) {
+        CHECK_THAT(segments[i].Length(), Catch::WithinAbs(lengths[i], 1e-6));
+        CHECK(segments[i].GetMaterialId() == materials[i]);
+    }
+
+    std::vector<NuGeom::Ray> rays;
+    for(double y = -4.5; y <= 4.5; y += 0.75) {
+        rays.emplace_back(NuGeom::Vector3D{-5, y, 0.3}, NuGeom::Vector3D{1, 0, 0});
+        rays.emplace_back(NuGeom::Vector3D{-5, y, 0.3}, NuGeom::Vector3D{1, 0.3, 0.1});
+    }
+    CheckBatchedSegments(NuGeom::World(world), rays);
+}
+
+TEST_CASE("Batched ray tracing", "[Volume]") {
+    NuGeom::Material mat("Water", 1.0, 2);
+    mat.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    mat.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    auto world_box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{100, 100, 100});
+    auto world_vol = std::make_shared<LogicalVolume>(mat, world_box);
+    auto box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{2, 2, 2});
+    auto sphere = std::make_shared<NuGeom::Sphere>(1);
+    auto box_vol = std::make_shared<LogicalVolume>(mat, box);
+    auto sphere_vol = std::make_shared<LogicalVolume>(mat, sphere);
+    world_vol -> AddDaughter(std::make_shared<PhysicalVolume>(box_vol, NuGeom::Translation3D{0, 0, 10},
+                                                              NuGeom::RotationZ3D(0.5)));
+    world_vol -> AddDaughter(std::make_shared<PhysicalVolume>(sphere_vol, NuGeom::Translation3D{3, 0, 5},
+                                                              NuGeom::Transform3D{}));
+    box_vol -> SetMother(world_vol);
+    sphere_vol -> SetMother(world_vol);
+    NuGeom::World world(world_vol);
+
+    std::vector<NuGeom::Ray> rays;
+    for(double x = -4; x <= 4; x += 0.5) {
+        rays.emplace_back(NuGeom::Vector3D{x, 0.1, -20}, NuGeom::Vector3D{0, 0, 1});
+        rays.emplace_back(NuGeom::Vector3D{x, 0, -20}, NuGeom::Vector3D{0.1, 0, 1});
+    }
+    NuGeom::RayBatch batch(rays);
+    REQUIRE(batch.Size() == rays.size());
+
+    std::vector<double> distances;
+    std::vector<size_t> idxs;
+    world.RayTrace(batch, distances, idxs);
+    auto segments = world.GetLineSegments(batch);
+    for(size_t i = 0; i < rays.size(); ++i) {
+        double distance = 0;
+        size_t idx = 0;
+        if(world.RayTrace(rays[i], distance, idx)) {
+            CHECK(distances[i] == Approx(distance));
+            CHECK(idxs[i] == idx);
+        } else {
+            CHECK(distances[i] == std::numeric_limits<double>::infinity());
+            CHECK(idxs[i] == 0);
+        }
+        CHECK(segments[i].size() == world.GetLineSegments(rays[i]).size());
+    }
+
+    SECTION("Segments of the batch in a single buffer") {
+        std::vector<NuGeom::SegmentRecord> records;
+        std::vector<size_t> offsets;
+        world.GetLineSegments(batch, records, offsets);
+        REQUIRE(offsets.size() == rays.size() + 1);
+        CHECK(offsets.back() == records.size());
+        for(size_t i = 0; i < rays.size(); ++i) {
+            REQUIRE(offsets[i+1] - offsets[i] == segments[i].size());
+            for(size_t j = 0; j < segments[i].size(); ++j) {
+                CHECK_THAT(records[offsets[i] + j].Length(), Catch::WithinAbs(segments[i][j].Length(), 1e-8));
+            }
+        }
+    }
+
+    SECTION("Shape batch matches the scalar intersection") {
+        std::vector<double> times;
+        sphere -> Intersect(batch, times);
+        for(size_t i = 0; i < rays.size(); ++i) {
+            CHECK(times[i] == sphere -> Intersect(rays[i]));
+        }
+    }
+}
+
+TEST_CASE("Column density", "[Volume]") {
+    NuGeom::Material water("Water", 1.0, 2);
+    water.AddElement(NuGeom::Element("Hydrogen", 1, 1), 2);
+    water.AddElement(NuGeom::Element("Oxygen", 8, 16), 1);
+    NuGeom::Material iron("Iron", 7.8, 1);
+    iron.AddElement(NuGeom::Element("Iron", 26, 56), 1);
+    auto world_box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{10, 10, 10});
+    auto world_vol = std::make_shared<LogicalVolume>(water, world_box);
+    auto box = std::make_shared<NuGeom::Box>(NuGeom::Vector3D{2, 2, 2});
+    auto box_vol = std::make_shared<LogicalVolume>(iron, box);
+    world_vol -> AddDaughter(std::make_shared<PhysicalVolume>(box_vol, NuGeom::Translation3D{0, 0, 2},
+                                                              NuGeom::RotationZ3D(0.3)));
+    box_vol -> SetMother(world_vol);
+    NuGeom::World world(world_vol);
+
+    NuGeom::Ray ray({0.2, -0.1, -5}, {0, 0, 1});
+    std::vector<double> per_material, per_element;
+    world.ColumnDensity(ray, per_material, &per_element);
+    // Reusing the buffers gives the same result
+    world.ColumnDensity(ray, per_material, &per_element);
+
+    REQUIRE(per_material.size() >= NuGeom::MaterialTable::Global().Size());
+    CHECK_THAT(per_material[world_vol -> GetMaterialId()], Catch::WithinAbs(8*1.0, 1e-6));
+    CHECK_THAT(per_material[box_vol -> GetMaterialId()], Catch::WithinAbs(2*7.8, 1e-6));
+
+    std::vector<NuGeom::SegmentRecord> segments;
+    world_vol -> GetSegments(ray, segments);
+    double total = 0;
+    for(const auto &segment : segments)
+        total += segment.Length()*NuGeom::MaterialTable::Global().Get(segment.material).Density();
+    CHECK_THAT(std::accumulate(per_material.begin(), per_material.end(), 0.0), Catch::WithinAbs(total, 1e-10));
+
+    // Masses of 1 and 56 differ from the natural hydrogen and iron, so these are isotopes
+    const auto hydrogen = water.Elements()[0].Id(), oxygen = water.Elements()[1].Id();
+    const auto iron_id = iron.Elements()[0].Id();
+    CHECK(oxygen == 8);
+    REQUIRE(per_element.size() > std::max({hydrogen, oxygen, iron_id}));
+    CHECK_THAT(per_element[hydrogen] + per_element[oxygen], Catch::WithinAbs(8*1.0, 1e-6));
+    CHECK_THAT(per_element[hydrogen]/per_element[oxygen], Catch::WithinAbs(2.0/16, 1e-10));
+    CHECK_THAT(per_element[iron_id], Catch::WithinAbs(2*7.8, 1e-6));
 }